@@ -0,0 +1,252 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "util/Clock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount = 0;
+static std::atomic<uint64_t> allocationBytes = 0;
+
+//counts every allocation of the process
+//on windows the allocations inside the tridot2d dll are not counted, since the dll has its own operator new
+static void* countedAlloc(size_t size, size_t alignment) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	if (size == 0) {
+		size = 1;
+	}
+	void* ptr = nullptr;
+	if (alignment <= alignof(std::max_align_t)) {
+		ptr = std::malloc(size);
+	}
+	else {
+#if defined(_WIN32)
+		ptr = _aligned_malloc(size, alignment);
+#else
+		ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+static void countedFree(void* ptr, size_t alignment) {
+	if (alignment <= alignof(std::max_align_t)) {
+		std::free(ptr);
+	}
+	else {
+#if defined(_WIN32)
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+}
+
+void* operator new(size_t size) {
+	return countedAlloc(size, 0);
+}
+
+void* operator new[](size_t size) {
+	return countedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return countedAlloc(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return countedAlloc(size, (size_t)alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+	countedFree(ptr, 0);
+}
+
+void operator delete[](void* ptr) noexcept {
+	countedFree(ptr, 0);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+	countedFree(ptr, 0);
+}
+
+void operator delete[](void* ptr, size_t size) noexcept {
+	countedFree(ptr, 0);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+	countedFree(ptr, (size_t)alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+	countedFree(ptr, (size_t)alignment);
+}
+
+void operator delete(void* ptr, size_t size, std::align_val_t alignment) noexcept {
+	countedFree(ptr, (size_t)alignment);
+}
+
+void operator delete[](void* ptr, size_t size, std::align_val_t alignment) noexcept {
+	countedFree(ptr, (size_t)alignment);
+}
+
+namespace tridot2d {
+
+	class BenchEntry {
+	public:
+		std::string name;
+		std::function<void(Bench&)> function;
+	};
+
+	static std::vector<BenchEntry>& getBenchEntries() {
+		static std::vector<BenchEntry> entries;
+		return entries;
+	}
+
+	void Bench::add(const std::string& name, const std::function<void(Bench&)>& function) {
+		getBenchEntries().push_back({ name, function });
+	}
+
+	uint64_t Bench::getAllocationCount() {
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t Bench::getAllocationBytes() {
+		return allocationBytes.load(std::memory_order_relaxed);
+	}
+
+	void Bench::measure(int64_t opsPerSample, const std::function<void()>& sample, const std::function<void()>& setup) {
+		measure("", opsPerSample, sample, setup);
+	}
+
+	void Bench::measure(const std::string& name, int64_t opsPerSample, const std::function<void()>& sample, const std::function<void()>& setup) {
+		Result result;
+		result.name = name.empty() ? this->name : this->name + "/" + name;
+		if (!options.filter.empty() && result.name.find(options.filter) == std::string::npos) {
+			return;
+		}
+		result.opsPerSample = std::max<int64_t>(opsPerSample, 1);
+
+		std::vector<double> times;
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		double total = 0;
+		while (times.size() < options.maxSamples && (times.size() < options.minSamples || total < options.seconds)) {
+			if (setup) {
+				setup();
+			}
+			uint64_t startAllocations = getAllocationCount();
+			uint64_t startBytes = getAllocationBytes();
+			uint64_t start = Clock::nowNano();
+			sample();
+			uint64_t time = Clock::nowNano() - start;
+			allocations += getAllocationCount() - startAllocations;
+			bytes += getAllocationBytes() - startBytes;
+			times.push_back((double)time / result.opsPerSample);
+			total += time / 1000000000.0;
+		}
+
+		std::sort(times.begin(), times.end());
+		auto percentile = [&](double p) {
+			return times[std::min(times.size() - 1, (size_t)(p * (times.size() - 1) + 0.5))];
+		};
+		result.samples = times.size();
+		for (double time : times) {
+			result.meanNs += time;
+		}
+		result.meanNs /= times.size();
+		result.minNs = times.front();
+		result.p50Ns = percentile(0.5);
+		result.p90Ns = percentile(0.9);
+		result.p99Ns = percentile(0.99);
+		result.maxNs = times.back();
+		result.allocationsPerOp = (double)allocations / (result.opsPerSample * times.size());
+		result.bytesPerOp = (double)bytes / (result.opsPerSample * times.size());
+
+		printf("%-48s %12.1f %12.1f %12.1f %12.1f %10.2f %10.1f %6d\n",
+			result.name.c_str(), result.meanNs, result.p50Ns, result.p90Ns, result.p99Ns,
+			result.allocationsPerOp, result.bytesPerOp, result.samples);
+		fflush(stdout);
+		results.push_back(result);
+	}
+
+	std::vector<Bench::Result> Bench::runAll(const Options& options) {
+		printf("%-48s %12s %12s %12s %12s %10s %10s %6s\n", "benchmark", "mean ns/op", "p50", "p90", "p99", "allocs/op", "bytes/op", "runs");
+		std::vector<Result> results;
+		for (auto& entry : getBenchEntries()) {
+			Bench bench;
+			bench.name = entry.name;
+			bench.options = options;
+			entry.function(bench);
+			results.insert(results.end(), bench.results.begin(), bench.results.end());
+		}
+		return results;
+	}
+
+	std::string Bench::toJson(const std::vector<Result>& results) {
+		std::string json = "{\n\t\"benchmarks\": [\n";
+		char buffer[1024];
+		for (int i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			snprintf(buffer, sizeof(buffer),
+				"\t\t{\"name\": \"%s\", \"samples\": %d, \"ops_per_sample\": %lld, \"mean_ns\": %.3f, \"min_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"max_ns\": %.3f, \"allocations_per_op\": %.4f, \"bytes_per_op\": %.2f}%s\n",
+				r.name.c_str(), r.samples, (long long)r.opsPerSample, r.meanNs, r.minNs, r.p50Ns, r.p90Ns, r.p99Ns, r.maxNs,
+				r.allocationsPerOp, r.bytesPerOp, i + 1 < results.size() ? "," : "");
+			json += buffer;
+		}
+		json += "\t]\n}\n";
+		return json;
+	}
+
+}
+
+using namespace tridot2d;
+
+int main(int argc, char* argv[]) {
+	Bench::Options options;
+	std::string jsonFile;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--json" && i + 1 < argc) {
+			jsonFile = argv[++i];
+		}
+		else if (arg == "--filter" && i + 1 < argc) {
+			options.filter = argv[++i];
+		}
+		else if (arg == "--seconds" && i + 1 < argc) {
+			options.seconds = std::atof(argv[++i]);
+		}
+		else if (arg == "--quick") {
+			options.seconds = 0.05;
+			options.minSamples = 2;
+		}
+		else {
+			printf("usage: tridot2d_bench [--json file] [--filter text] [--seconds time] [--quick]\n");
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	std::vector<Bench::Result> results = Bench::runAll(options);
+
+	if (!jsonFile.empty()) {
+		std::ofstream stream(jsonFile);
+		if (!stream) {
+			printf("could not write %s\n", jsonFile.c_str());
+			return 1;
+		}
+		stream << Bench::toJson(results);
+	}
+	return 0;
+}
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+namespace tridot2d {
+
+	//minimal benchmark harness for tridot2d_bench, runs without a window or graphics context
+	class Bench {
+	public:
+		class Result {
+		public:
+			std::string name;
+			int samples = 0;
+			int64_t opsPerSample = 0;
+			double meanNs = 0;
+			double minNs = 0;
+			double p50Ns = 0;
+			double p90Ns = 0;
+			double p99Ns = 0;
+			double maxNs = 0;
+			double allocationsPerOp = 0;
+			double bytesPerOp = 0;
+		};
+
+		class Options {
+		public:
+			//time spent measuring one benchmark, at least minSamples are taken
+			double seconds = 0.5;
+			int minSamples = 5;
+			int maxSamples = 1000;
+			std::string filter;
+		};
+
+		//runs sample repeatedly, every call performs opsPerSample operations
+		//setup runs before every sample and is not measured
+		void measure(int64_t opsPerSample, const std::function<void()>& sample, const std::function<void()>& setup = nullptr);
+
+		//measures a single named case, a benchmark function can measure several cases
+		void measure(const std::string& name, int64_t opsPerSample, const std::function<void()>& sample, const std::function<void()>& setup = nullptr);
+
+		static void add(const std::string& name, const std::function<void(Bench&)>& function);
+		static std::vector<Result> runAll(const Options& options);
+		static std::string toJson(const std::vector<Result>& results);
+
+		//allocations done through the global operator new since the start of the process
+		static uint64_t getAllocationCount();
+		static uint64_t getAllocationBytes();
+
+	private:
+		std::string name;
+		Options options;
+		std::vector<Result> results;
+	};
+
+	//registers a benchmark function at static initialization
+	class BenchRegistration {
+	public:
+		BenchRegistration(const std::string& name, const std::function<void(Bench&)>& function) {
+			Bench::add(name, function);
+		}
+	};
+
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "core/EntitySystem.h"
+#include <vector>
+
+using namespace tridot2d;
+
+template<int I>
+class BenchComponent : public Component {
+public:
+	int value = I;
+};
+
+template<int... I>
+void addComponents(Entity* entity, std::integer_sequence<int, I...>) {
+	(entity->addComponent(BenchComponent<I>()), ...);
+}
+
+//looks up every component type that was added to the entities
+template<bool dynamicCast, int... I>
+int lookupAll(std::vector<Entity*>& entities, std::integer_sequence<int, I...>) {
+	int sum = 0;
+	for (auto* entity : entities) {
+		if constexpr (dynamicCast) {
+			((sum += entity->findComponent<BenchComponent<I>>()->value), ...);
+		}
+		else {
+			((sum += entity->getComponent<BenchComponent<I>>()->value), ...);
+		}
+	}
+	return sum;
+}
+
+template<int count>
+void runLookup(Bench& bench, int entityCount) {
+	using Sequence = std::make_integer_sequence<int, count>;
+
+	std::vector<Entity*> entities;
+	for (int i = 0; i < entityCount; i++) {
+		Entity* entity = new Entity();
+		addComponents(entity, Sequence());
+		entities.push_back(entity);
+	}
+
+	volatile int sink = 0;
+	std::string suffix = std::to_string(count);
+	bench.measure("dynamic_cast/" + suffix, (int64_t)entityCount * count, [&]() {
+		sink = sink + lookupAll<true>(entities, Sequence());
+	});
+	bench.measure("type_id/" + suffix, (int64_t)entityCount * count, [&]() {
+		sink = sink + lookupAll<false>(entities, Sequence());
+	});
+
+	for (auto* entity : entities) {
+		delete entity;
+	}
+}
+
+static BenchRegistration componentLookup("component_lookup", [](Bench& bench) {
+	runLookup<1>(bench, 10000);
+	runLookup<4>(bench, 10000);
+	runLookup<16>(bench, 10000);
+});
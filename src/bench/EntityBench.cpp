@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "core/EntitySystem.h"
+#include "common/TaskManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+using namespace tridot2d;
+
+template<int I>
+class UpdateComponent : public Component {
+public:
+	float value = 0;
+
+	void update() override {
+		value += 1;
+	}
+};
+
+//moves its entity, so passes of different move components must not run concurrently
+template<int I>
+class MoveComponent : public Component {
+public:
+	glm::vec2 velocity = { 1, 0 };
+
+	void update() override {
+		entity->setPosition(entity->position + velocity * 0.01f);
+	}
+};
+
+template<int... I>
+void addUpdateComponents(Entity* entity, std::integer_sequence<int, I...>) {
+	(entity->addComponent(UpdateComponent<I>()), ...);
+}
+
+static const char* getStorageName(ComponentStorage storage) {
+	return storage == ComponentStorage::ARCHETYPE ? "archetype" : "default";
+}
+
+static void runSpawn(Bench& bench, ComponentStorage storage, int count) {
+	std::string suffix = std::string(getStorageName(storage)) + "/" + std::to_string(count);
+	std::unique_ptr<EntitySystem> entitySystem;
+	Entity prototype;
+	addUpdateComponents(&prototype, std::make_integer_sequence<int, 4>());
+
+	auto create = [&]() {
+		entitySystem = std::make_unique<EntitySystem>();
+		entitySystem->storage = storage;
+	};
+	auto populate = [&]() {
+		create();
+		entitySystem->spawn(prototype, count);
+		entitySystem->updatePending();
+	};
+
+	bench.measure("spawn/" + suffix, count, [&]() {
+		for (int i = 0; i < count; i++) {
+			entitySystem->addEntity(prototype);
+		}
+		entitySystem->updatePending();
+	}, create);
+
+	bench.measure("spawn_batch/" + suffix, count, [&]() {
+		entitySystem->spawn(prototype, count);
+		entitySystem->updatePending();
+	}, create);
+
+	bench.measure("despawn/" + suffix, count, [&]() {
+		for (auto* entity : entitySystem->entities) {
+			entity->removeEntity();
+		}
+		entitySystem->updatePending();
+	}, populate);
+
+	entitySystem = nullptr;
+}
+
+template<int componentCount>
+static void runUpdate(Bench& bench, ComponentStorage storage, int entityCount) {
+	EntitySystem entitySystem;
+	entitySystem.storage = storage;
+	Entity prototype;
+	addUpdateComponents(&prototype, std::make_integer_sequence<int, componentCount>());
+	entitySystem.spawn(prototype, entityCount);
+	entitySystem.update();
+
+	std::string name = std::string(getStorageName(storage)) + "/" + std::to_string(entityCount) + "x" + std::to_string(componentCount);
+	bench.measure(name, entityCount, [&]() {
+		entitySystem.update();
+	});
+}
+
+//two update passes that both write the entity transform run one after the other, passes of other components share a stage
+static void runPasses(Bench& bench, int entityCount) {
+	TaskManager taskManager;
+	taskManager.start(std::max(1, (int)std::thread::hardware_concurrency() - 1));
+	EntitySystem entitySystem;
+	entitySystem.taskManager = &taskManager;
+	entitySystem.addPass<MoveComponent<0>>("move0").write<EntityTransform>();
+	entitySystem.addPass<MoveComponent<1>>("move1").write<EntityTransform>();
+	entitySystem.addPass<UpdateComponent<0>>("update0");
+	entitySystem.addPass<UpdateComponent<1>>("update1");
+	if (entitySystem.getPassStage("move0") == entitySystem.getPassStage("move1")) {
+		printf("unexpected pass stages\n");
+	}
+	if (entitySystem.getPassStage("update0") != entitySystem.getPassStage("update1")) {
+		printf("unexpected pass stages\n");
+	}
+
+	Entity prototype;
+	prototype.addComponent(MoveComponent<0>());
+	prototype.addComponent(MoveComponent<1>());
+	prototype.addComponent(UpdateComponent<0>());
+	prototype.addComponent(UpdateComponent<1>());
+	entitySystem.spawn(prototype, entityCount);
+	entitySystem.update();
+
+	bench.measure("passes/" + std::to_string(entityCount), entityCount, [&]() {
+		entitySystem.update();
+	});
+
+	entitySystem.clear();
+	taskManager.stop();
+}
+
+static BenchRegistration entitySpawn("entity", [](Bench& bench) {
+	for (auto storage : { ComponentStorage::DEFAULT, ComponentStorage::ARCHETYPE }) {
+		runSpawn(bench, storage, 1000);
+		runSpawn(bench, storage, 10000);
+	}
+});
+
+static BenchRegistration entityUpdate("entity_update", [](Bench& bench) {
+	for (auto storage : { ComponentStorage::DEFAULT, ComponentStorage::ARCHETYPE }) {
+		for (int entityCount : { 1000, 10000, 100000 }) {
+			runUpdate<1>(bench, storage, entityCount);
+			runUpdate<4>(bench, storage, entityCount);
+			runUpdate<8>(bench, storage, entityCount);
+		}
+	}
+	for (int entityCount : { 10000, 100000 }) {
+		runPasses(bench, entityCount);
+	}
+});
@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "particles/ParticleSystem.h"
+#include "render/Renderer2D.h"
+#include "systems/Time.h"
+#include "common/Singleton.h"
+
+using namespace tridot2d;
+
+static void runParticles(Bench& bench, int count) {
+	Singleton::get<Time>()->deltaTime = 1.0f / 60.0f;
+	ParticleSystem particles;
+	particles.init();
+	for (int i = 0; i < count; i++) {
+		Particle& particle = particles.addParticle();
+		particle.position = { (i % 100) * 0.1f, (i / 100) * 0.1f };
+		particle.velocity = { 1, 2 };
+		particle.acceleration = { 0, -10 };
+		particle.angular = 1;
+		particle.endSize = { 0.2f, 0.2f };
+		particle.startColor = { 1, 0, 0, 1 };
+		particle.endColor = { 0, 0, 1, 0 };
+		particle.lifeTime = 1000000;
+		particle.fadeInTime = 0.5f;
+		particle.fadeOutTime = 0.5f;
+		particle.type = i % 2 ? ParticleType::QUAD : ParticleType::CIRCLE;
+	}
+
+	//the renderer is never initialized, it only collects the submitted quads and is replaced between samples
+	bench.measure(std::to_string(count), count, [&]() {
+		particles.update();
+	}, []() {
+		Singleton::set<Renderer2D>(new Renderer2D());
+	});
+	Singleton::reset<Renderer2D>();
+}
+
+static BenchRegistration particleUpdate("particle_update", [](Bench& bench) {
+	runParticles(bench, 1000);
+	runParticles(bench, 10000);
+});
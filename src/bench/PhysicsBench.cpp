@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "physics/PhysicsSystem.h"
+#include <cmath>
+
+using namespace tridot2d;
+
+//a pile of boxes falling onto a static ground, the pile fits into the default static grid of the physics system
+static void createBoxPile(PhysicsSystem& physics, int count) {
+	int side = (int)std::ceil(std::sqrt((float)count));
+	float spacing = std::min(1.0f, 90.0f / side);
+
+	Body* ground = physics.addBody();
+	ground->type = BodyType::STATIC;
+	ground->position = { 0, -46 };
+	ground->scale = { 100, 1 };
+
+	for (int i = 0; i < count; i++) {
+		Body* body = physics.addBody();
+		body->type = BodyType::DYNAMIC;
+		body->position = { (i % side - side * 0.5f) * spacing, -45 + (i / side + 0.5f) * spacing };
+		body->scale = { spacing * 0.9f, spacing * 0.9f };
+		body->gravity = { 0, -10 };
+		body->drag = { 1, 1 };
+	}
+}
+
+//boxes of mixed sizes scattered over a world much larger than the default static grid
+static void createScattered(PhysicsSystem& physics, int count) {
+	uint32_t seed = 1;
+	auto random = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) / (float)(1 << 24);
+	};
+	for (int i = 0; i < count; i++) {
+		Body* body = physics.addBody();
+		body->type = BodyType::DYNAMIC;
+		body->position = { (random() - 0.5f) * 2000, (random() - 0.5f) * 2000 };
+		float size = i % 100 == 0 ? 20.0f : 0.5f + random();
+		body->scale = { size, size };
+		body->velocity = { random() - 0.5f, random() - 0.5f };
+	}
+}
+
+//a side scrolling level, a long ground with boxes walking and falling on it
+static void createLevel(PhysicsSystem& physics, int count) {
+	float length = count * 2.0f;
+
+	Body* ground = physics.addBody();
+	ground->type = BodyType::STATIC;
+	ground->position = { 0, -1 };
+	ground->scale = { length, 1 };
+
+	uint32_t seed = 1;
+	auto random = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) / (float)(1 << 24);
+	};
+	for (int i = 0; i < count; i++) {
+		Body* body = physics.addBody();
+		body->type = BodyType::DYNAMIC;
+		body->position = { (random() - 0.5f) * length, random() * 20 };
+		body->scale = { 1, 1 };
+		body->velocity = { (random() - 0.5f) * 4, 0 };
+		body->gravity = { 0, -10 };
+	}
+}
+
+static void runStep(Bench& bench, const std::string& name, int count, BroadPhaseType broadPhaseType, void (*create)(PhysicsSystem&, int)) {
+	PhysicsSystem physics;
+	physics.init(broadPhaseType);
+	create(physics, count);
+
+	bench.measure(name, 1, [&]() {
+		physics.step(1.0f / 60.0f);
+	});
+}
+
+static BenchRegistration physicsStep("physics_step", [](Bench& bench) {
+	for (int count : { 1000, 10000, 100000 }) {
+		runStep(bench, std::to_string(count), count, BroadPhaseType::STATIC_GRID, createBoxPile);
+		runStep(bench, "dynamic_tree/" + std::to_string(count), count, BroadPhaseType::DYNAMIC_TREE, createBoxPile);
+		runStep(bench, "sweep_and_prune/" + std::to_string(count), count, BroadPhaseType::SWEEP_AND_PRUNE, createBoxPile);
+	}
+
+	//most bodies are outside of the static grid, which tests them against each other
+	for (int count : { 1000, 5000 }) {
+		runStep(bench, "scattered/static_grid/" + std::to_string(count), count, BroadPhaseType::STATIC_GRID, createScattered);
+		runStep(bench, "scattered/dynamic_tree/" + std::to_string(count), count, BroadPhaseType::DYNAMIC_TREE, createScattered);
+		runStep(bench, "scattered/sweep_and_prune/" + std::to_string(count), count, BroadPhaseType::SWEEP_AND_PRUNE, createScattered);
+	}
+
+	for (int count : { 1000, 5000 }) {
+		runStep(bench, "level/each/" + std::to_string(count), count, BroadPhaseType::EACH, createLevel);
+		runStep(bench, "level/static_grid/" + std::to_string(count), count, BroadPhaseType::STATIC_GRID, createLevel);
+		runStep(bench, "level/dynamic_tree/" + std::to_string(count), count, BroadPhaseType::DYNAMIC_TREE, createLevel);
+		runStep(bench, "level/sweep_and_prune/" + std::to_string(count), count, BroadPhaseType::SWEEP_AND_PRUNE, createLevel);
+	}
+});
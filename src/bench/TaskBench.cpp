@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "common/TaskManager.h"
+#include "common/TaskGraph.h"
+#include "common/Task.h"
+#include "common/TaskFuture.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace tridot2d;
+
+static Task<int> scheduleHops(TaskManager& taskManager, int count) {
+	int hops = 0;
+	for (int i = 0; i < count; i++) {
+		co_await taskManager.schedule();
+		hops++;
+	}
+	co_return hops;
+}
+
+//awaits a task that was already started, the second await finds it finished
+static Task<int> awaitTwice(Task<int>& task) {
+	int first = co_await task;
+	int second = co_await task;
+	co_return first + second;
+}
+
+static void runTasks(Bench& bench, int workerCount, int taskCount) {
+	TaskManager taskManager;
+	taskManager.start(workerCount);
+	std::atomic<int> counter = 0;
+	std::vector<uint64_t> taskIds;
+	taskIds.reserve(taskCount);
+
+	std::string suffix = std::to_string(workerCount) + "_workers";
+	bench.measure("add_join/" + suffix, taskCount, [&]() {
+		taskIds.clear();
+		for (int i = 0; i < taskCount; i++) {
+			taskIds.push_back(taskManager.addTask([&]() {
+				counter++;
+			}));
+		}
+		for (uint64_t taskId : taskIds) {
+			taskManager.joinTask(taskId);
+		}
+	});
+
+	//the same with queue latency and execution time measured for every task
+	taskManager.setProfiling(true);
+	bench.measure("add_join_profiled/" + suffix, taskCount, [&]() {
+		taskIds.clear();
+		for (int i = 0; i < taskCount; i++) {
+			taskIds.push_back(taskManager.addTask([&]() {
+				counter++;
+			}));
+		}
+		for (uint64_t taskId : taskIds) {
+			taskManager.joinTask(taskId);
+		}
+	});
+	taskManager.setProfiling(false);
+
+	//a capture that is too large for the small buffer of std::function but fits into TaskFunction
+	int64_t values[5] = { 1, 2, 3, 4, 5 };
+	auto largeCapture = [&counter, v0 = values[0], v1 = values[1], v2 = values[2], v3 = values[3], v4 = values[4]]() {
+		counter += (int)(v0 + v1 + v2 + v3 + v4);
+	};
+	bench.measure("add_join_capture48/" + suffix, taskCount, [&]() {
+		taskIds.clear();
+		for (int i = 0; i < taskCount; i++) {
+			taskIds.push_back(taskManager.addTask(largeCapture));
+		}
+		for (uint64_t taskId : taskIds) {
+			taskManager.joinTask(taskId);
+		}
+	});
+
+	//the same callable passed as std::function, which allocates for the capture
+	bench.measure("add_join_capture48_std_function/" + suffix, taskCount, [&]() {
+		taskIds.clear();
+		for (int i = 0; i < taskCount; i++) {
+			taskIds.push_back(taskManager.addTask(std::function<void()>(largeCapture)));
+		}
+		for (uint64_t taskId : taskIds) {
+			taskManager.joinTask(taskId);
+		}
+	});
+
+	//futures share their result with the task, which costs one allocation per task
+	std::vector<TaskFuture<int>> futures;
+	futures.reserve(taskCount);
+	bench.measure("submit_get/" + suffix, taskCount, [&]() {
+		futures.clear();
+		for (int i = 0; i < taskCount; i++) {
+			futures.push_back(taskManager.submit([i]() {
+				return i;
+			}));
+		}
+		for (auto& future : futures) {
+			counter += future.get();
+		}
+	});
+	futures.clear();
+
+	//a chain of tasks where each task adds the next one
+	bench.measure("chain/" + suffix, taskCount, [&]() {
+		std::atomic<int> remaining = taskCount;
+		std::function<void()> next = [&]() {
+			if (--remaining > 0) {
+				taskManager.addTask(next);
+			}
+		};
+		taskManager.joinTask(taskManager.addTask(next));
+		while (remaining > 0) {
+			std::this_thread::yield();
+		}
+	});
+
+	//time until a high priority task ran while a backlog of low priority tasks is pending
+	bench.measure("high_priority_latency/1000_low/" + suffix, 1, [&]() {
+		taskManager.joinTask(taskManager.addTask([&]() {
+			counter++;
+		}, TaskPriority::HIGH));
+	}, [&]() {
+		for (uint64_t taskId : taskIds) {
+			taskManager.joinTask(taskId);
+		}
+		taskIds.clear();
+		for (int i = 0; i < 1000; i++) {
+			taskIds.push_back(taskManager.addTask([&]() {
+				counter++;
+			}, TaskPriority::LOW));
+		}
+	});
+	for (uint64_t taskId : taskIds) {
+		taskManager.joinTask(taskId);
+	}
+
+	//a coroutine that suspends and is resumed as a task on every iteration
+	bench.measure("coroutine_schedule/" + suffix, taskCount, [&]() {
+		Task<int> task = scheduleHops(taskManager, taskCount);
+		task.wait(&taskManager);
+	});
+
+	//the result stays in the task and can be awaited again
+	bench.measure("coroutine_await_started/" + suffix, 1, [&]() {
+		Task<int> task = scheduleHops(taskManager, 1);
+		task.start();
+		Task<int> sum = awaitTwice(task);
+		sum.wait(&taskManager);
+		if (sum.getResult() != 2) {
+			printf("unexpected coroutine result\n");
+		}
+	});
+
+	taskManager.stop();
+}
+
+static void runParallel(Bench& bench, int workerCount, int count) {
+	TaskManager taskManager;
+	taskManager.start(workerCount);
+	std::vector<float> values(count, 1.0f);
+
+	std::string suffix = std::to_string(count) + "/" + std::to_string(workerCount) + "_workers";
+	bench.measure("parallel_for/" + suffix, count, [&]() {
+		taskManager.parallelFor(0, count, 0, [&](int i) {
+			values[i] = values[i] * 0.5f + 1.0f;
+		});
+	});
+
+	bench.measure("parallel_reduce/" + suffix, count, [&]() {
+		float sum = taskManager.parallelReduce(0, count, 0, 0.0f, [&](int i, float& value) {
+			value += values[i];
+		}, [](float a, float b) {
+			return a + b;
+		});
+		if (sum < 0) {
+			printf("unexpected sum\n");
+		}
+	});
+
+	taskManager.stop();
+}
+
+//a frame pipeline with a fan out of small jobs in the middle, one op is one node
+static void runGraph(Bench& bench, int workerCount, int jobCount) {
+	TaskManager taskManager;
+	taskManager.start(workerCount);
+	std::atomic<int> counter = 0;
+
+	TaskGraph graph;
+	int input = graph.addNode([&]() { counter++; }, "input");
+	int physics = graph.addContinuation(input, [&]() { counter++; }, "physics");
+	int gameplay = graph.addContinuation(physics, [&]() { counter++; }, "gameplay");
+	int render = graph.addNode([&]() { counter++; }, "render");
+	for (int i = 0; i < jobCount; i++) {
+		graph.addDependency(render, graph.addContinuation(gameplay, [&]() { counter++; }));
+	}
+
+	bench.measure("graph/" + std::to_string(workerCount) + "_workers", graph.getNodeCount(), [&]() {
+		graph.run(&taskManager);
+	});
+
+	taskManager.stop();
+}
+
+static BenchRegistration taskThroughput("task", [](Bench& bench) {
+	int maxWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+	for (int workerCount : { 1, 2, 4, 8 }) {
+		if (workerCount <= maxWorkers || workerCount == 1) {
+			runTasks(bench, workerCount, 10000);
+			runParallel(bench, workerCount, 1000000);
+			runGraph(bench, workerCount, 64);
+		}
+	}
+});
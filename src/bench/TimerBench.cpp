@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Bench.h"
+#include "common/TaskManager.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace tridot2d;
+
+static BenchRegistration timer("timer", [](Bench& bench) {
+	const int pendingCount = 100000;
+	TaskManager taskManager;
+	taskManager.start(1);
+	std::vector<uint64_t> taskIds;
+	taskIds.reserve(pendingCount);
+
+	bench.measure("add_cancel/" + std::to_string(pendingCount), pendingCount, [&]() {
+		taskIds.clear();
+		for (int i = 0; i < pendingCount; i++) {
+			taskIds.push_back(taskManager.addTask([]() {}, TaskType::DELAYED, "", 3600000 + i % 1000));
+		}
+		for (uint64_t taskId : taskIds) {
+			taskManager.terminateTask(taskId);
+		}
+	});
+
+	//all timers fire within 10ms, measures until the last one ran
+	bench.measure("fire/" + std::to_string(pendingCount), pendingCount, [&]() {
+		std::atomic<int> fired = 0;
+		for (int i = 0; i < pendingCount; i++) {
+			taskManager.addTask([&]() {
+				fired++;
+			}, TaskType::DELAYED, "", i % 10);
+		}
+		while (fired < pendingCount) {
+			std::this_thread::yield();
+		}
+	});
+
+	//time from adding a 1ms timer until it ran, while many other timers are pending
+	taskIds.clear();
+	for (int i = 0; i < pendingCount; i++) {
+		taskIds.push_back(taskManager.addTask([]() {}, TaskType::DELAYED, "", 3600000 + i % 1000));
+	}
+	bench.measure("delay_1ms/" + std::to_string(pendingCount) + "_pending", 1, [&]() {
+		taskManager.joinTask(taskManager.addTask([]() {}, TaskType::DELAYED, "", 1));
+	});
+	for (uint64_t taskId : taskIds) {
+		taskManager.terminateTask(taskId);
+	}
+
+	taskManager.stop();
+});
@@ -22,6 +22,8 @@ namespace tridot2d {
 				id = 0;
 			}
 			id = Singleton::get<AudioSystem>()->play(audio);
+			//OpenAL can reuse the id of a stopped source
+			syncedId = 0;
 		}
 	}
 
@@ -34,6 +36,18 @@ namespace tridot2d {
 
 	void AudioSource::update() {
 		if (id != 0) {
+			uint32_t version = entity->getTransformVersion();
+			if (entity == syncedEntity && id == syncedId && (version == syncedVersion || !positional) && volume == syncedVolume && pitch == syncedPitch && positional == syncedPositional && looping == syncedLooping) {
+				return;
+			}
+			syncedEntity = entity;
+			syncedId = id;
+			syncedVersion = version;
+			syncedVolume = volume;
+			syncedPitch = pitch;
+			syncedPositional = positional;
+			syncedLooping = looping;
+
 			if (positional) {
 				alSourcei(id, AL_SOURCE_RELATIVE, AL_FALSE);
 				alSource3f(id, AL_POSITION, entity->position.x, entity->position.y, 0);
@@ -49,6 +63,14 @@ namespace tridot2d {
 	}
 
 	void AudioListener::update() {
+		uint32_t version = entity->getTransformVersion();
+		if (entity == syncedEntity && version == syncedVersion && volume == syncedVolume) {
+			return;
+		}
+		syncedEntity = entity;
+		syncedVersion = version;
+		syncedVolume = volume;
+
 		alListener3f(AL_POSITION, entity->position.x, entity->position.y, 0);
 		alListener3f(AL_VELOCITY, 0, 0, 0);
 		alListenerf(AL_GAIN, volume);
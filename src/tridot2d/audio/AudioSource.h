@@ -14,6 +14,11 @@ namespace tridot2d {
 		float volume = 1.0f;
 
 		void update() override;
+
+	private:
+		Entity* syncedEntity = nullptr;
+		uint32_t syncedVersion = 0;
+		float syncedVolume = 0;
 	};
 
 	class AudioSource : public Component {
@@ -31,6 +36,16 @@ namespace tridot2d {
 		void stop();
 
 		void update() override;
+
+	private:
+		//state of the OpenAL source when it was last updated
+		Entity* syncedEntity = nullptr;
+		uint32_t syncedId = 0;
+		uint32_t syncedVersion = 0;
+		float syncedVolume = 0;
+		float syncedPitch = 0;
+		bool syncedPositional = false;
+		bool syncedLooping = false;
 	};
 
 }
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Pool.h"
+#include <algorithm>
+
+namespace tridot2d {
+
+	static std::mutex& getPoolsMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<Pool*>& getPools() {
+		static std::vector<Pool*> pools;
+		return pools;
+	}
+
+	Pool::Pool(const std::string& name, size_t elementSize, size_t alignment) {
+		this->alignment = std::max(alignment, alignof(FreeBlock));
+		this->elementSize = std::max(elementSize, sizeof(FreeBlock));
+		this->elementSize = (this->elementSize + this->alignment - 1) / this->alignment * this->alignment;
+		slabSize = std::max(16, (int)(16 * 1024 / this->elementSize));
+		stats.name = name;
+		stats.elementSize = elementSize;
+
+		std::unique_lock<std::mutex> lock(getPoolsMutex());
+		getPools().push_back(this);
+	}
+
+	Pool::~Pool() {
+		{
+			std::unique_lock<std::mutex> lock(getPoolsMutex());
+			auto& pools = getPools();
+			pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+		}
+		for (auto* slab : slabs) {
+			::operator delete(slab, std::align_val_t(alignment));
+		}
+		slabs.clear();
+	}
+
+	void* Pool::allocate() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return allocateBlock();
+	}
+
+	void Pool::allocate(void** blocks, int count) {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (int i = 0; i < count; i++) {
+			blocks[i] = allocateBlock();
+		}
+	}
+
+	void* Pool::allocateBlock() {
+		void* block = nullptr;
+		if (freeList) {
+			block = freeList;
+			freeList = freeList->next;
+			stats.reuses++;
+		}
+		else {
+			if (freshCount == 0) {
+				fresh = (uint8_t*)::operator new(elementSize * slabSize, std::align_val_t(alignment));
+				freshCount = slabSize;
+				slabs.push_back(fresh);
+				stats.capacity += slabSize;
+			}
+			block = fresh;
+			fresh += elementSize;
+			freshCount--;
+		}
+
+		stats.allocations++;
+		stats.live++;
+		stats.peak = std::max(stats.peak, stats.live);
+		return block;
+	}
+
+	void Pool::deallocate(void* ptr) {
+		if (!ptr) {
+			return;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		FreeBlock* block = (FreeBlock*)ptr;
+		block->next = freeList;
+		freeList = block;
+		stats.live--;
+	}
+
+	Pool::Stats Pool::getStats() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	std::vector<Pool::Stats> Pool::getAllStats() {
+		std::unique_lock<std::mutex> lock(getPoolsMutex());
+		std::vector<Stats> result;
+		for (auto* pool : getPools()) {
+			result.push_back(pool->getStats());
+		}
+		return result;
+	}
+
+}
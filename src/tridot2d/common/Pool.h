@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <typeinfo>
+#include <cstdint>
+
+namespace tridot2d {
+
+	//allocator for blocks of a fixed size
+	//blocks are allocated in slabs and freed blocks are reused through a free list, slabs are only freed with the pool
+	class Pool {
+	public:
+		class Stats {
+		public:
+			std::string name;
+			size_t elementSize = 0;
+			int live = 0;
+			int peak = 0;
+			int capacity = 0;
+			uint64_t allocations = 0;
+			uint64_t reuses = 0;
+		};
+
+		Pool(const std::string& name, size_t elementSize, size_t alignment);
+		~Pool();
+
+		void* allocate();
+		//allocates count blocks with a single lock
+		void allocate(void** blocks, int count);
+		void deallocate(void* ptr);
+		Stats getStats();
+
+		template<typename T>
+		static Pool* get(const char* name = typeid(T).name()) {
+			static Pool pool(name, sizeof(T), alignof(T));
+			return &pool;
+		}
+
+		static std::vector<Stats> getAllStats();
+
+	private:
+		class FreeBlock {
+		public:
+			FreeBlock* next = nullptr;
+		};
+
+		std::mutex mutex;
+		std::vector<void*> slabs;
+		FreeBlock* freeList = nullptr;
+		uint8_t* fresh = nullptr;
+		int freshCount = 0;
+		size_t elementSize = 0;
+		size_t alignment = 0;
+		int slabSize = 0;
+		Stats stats;
+
+		void* allocateBlock();
+	};
+
+	//std allocator that takes single objects from the pool of the allocated type
+	template<typename T>
+	class PoolAllocator {
+	public:
+		using value_type = T;
+		const char* name = nullptr;
+
+		PoolAllocator(const char* name = typeid(T).name())
+			: name(name) {}
+
+		template<typename U>
+		PoolAllocator(const PoolAllocator<U>& allocator)
+			: name(allocator.name) {}
+
+		T* allocate(size_t count) {
+			if (count == 1) {
+				return (T*)Pool::get<T>(name)->allocate();
+			}
+			return (T*)::operator new(count * sizeof(T), std::align_val_t(alignof(T)));
+		}
+
+		void deallocate(T* ptr, size_t count) {
+			if (count == 1) {
+				Pool::get<T>(name)->deallocate(ptr);
+			}
+			else {
+				::operator delete(ptr, std::align_val_t(alignof(T)));
+			}
+		}
+
+		template<typename U>
+		bool operator==(const PoolAllocator<U>& allocator) const {
+			return true;
+		}
+	};
+
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "TaskManager.h"
+#include "Log.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace tridot2d {
+
+	template<typename T>
+	class TaskResult {
+	public:
+		std::optional<T> value;
+
+		template<typename U>
+		void return_value(U&& result) {
+			value.emplace(std::forward<U>(result));
+		}
+
+		T& get() {
+			return *value;
+		}
+
+		const T& get() const {
+			return *value;
+		}
+
+		T take() {
+			return std::move(*value);
+		}
+	};
+
+	template<>
+	class TaskResult<void> {
+	public:
+		void return_void() {}
+		void get() const {}
+		void take() {}
+	};
+
+	//lazily started coroutine that returns a T
+	//co_await on a task starts it if needed and continues the awaiting coroutine when it finished
+	//co_await task returns a const reference to the result and can be repeated, co_await std::move(task) moves the result out
+	//only one coroutine can wait for a task at a time
+	//the coroutine runs on the thread that resumes it, use co_await taskManager.schedule() to move it to a worker
+	//e.g.
+	//Task<Texture*> loadTexture(TaskManager& taskManager, std::string file) {
+	//	co_await taskManager.schedule();
+	//	co_return decode(file);
+	//}
+	template<typename T = void>
+	class Task {
+	public:
+		class promise_type : public TaskResult<T> {
+		public:
+			//nullptr while running, then the awaiting coroutine or the finished marker
+			std::atomic<void*> continuation = nullptr;
+			bool started = false;
+
+			Task get_return_object() {
+				return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+
+			auto final_suspend() noexcept {
+				class FinalAwaiter {
+				public:
+					bool await_ready() noexcept { return false; }
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+						void* continuation = handle.promise().continuation.exchange(finishedMarker(), std::memory_order_acq_rel);
+						if (continuation) {
+							return std::coroutine_handle<>::from_address(continuation);
+						}
+						return std::noop_coroutine();
+					}
+					void await_resume() noexcept {}
+				};
+				return FinalAwaiter();
+			}
+
+			void unhandled_exception() {
+				std::terminate();
+			}
+		};
+
+		template<bool move>
+		class Awaiter {
+		public:
+			std::coroutine_handle<promise_type> handle;
+
+			bool await_ready() {
+				return handle.promise().continuation.load(std::memory_order_acquire) == finishedMarker();
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+				promise_type& promise = handle.promise();
+				if (!promise.started) {
+					//the task runs on this thread until it suspends
+					promise.started = true;
+					promise.continuation.store(awaiting.address(), std::memory_order_relaxed);
+					return handle;
+				}
+				void* running = nullptr;
+				if (promise.continuation.compare_exchange_strong(running, awaiting.address(), std::memory_order_acq_rel)) {
+					return std::noop_coroutine();
+				}
+				if (running != finishedMarker()) {
+					Log::error("a task is awaited by more than one coroutine at the same time");
+					std::terminate();
+				}
+				//finished in the meantime
+				return awaiting;
+			}
+
+			decltype(auto) await_resume() {
+				if constexpr (move) {
+					return handle.promise().take();
+				}
+				else {
+					return std::as_const(handle.promise()).get();
+				}
+			}
+		};
+
+		Task() {}
+
+		Task(Task&& task) noexcept : handle(std::exchange(task.handle, nullptr)) {}
+
+		Task& operator=(Task&& task) noexcept {
+			if (this != &task) {
+				destroy();
+				handle = std::exchange(task.handle, nullptr);
+			}
+			return *this;
+		}
+
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		//the task must not be running anymore when it is destroyed
+		~Task() {
+			destroy();
+		}
+
+		Awaiter<false> operator co_await() & {
+			return Awaiter<false>{ handle };
+		}
+
+		Awaiter<true> operator co_await() && {
+			return Awaiter<true>{ handle };
+		}
+
+		//runs the coroutine on the calling thread until it suspends, the task can still be awaited afterwards
+		void start() {
+			if (handle && !handle.promise().started) {
+				handle.promise().started = true;
+				handle.resume();
+			}
+		}
+
+		//starts the task and waits until it finished, the calling thread executes pending tasks while waiting
+		void wait(TaskManager* taskManager) {
+			start();
+			if (!isFinished()) {
+				taskManager->waitUntil([this]() {
+					return isFinished();
+				});
+			}
+		}
+
+		bool isFinished() {
+			return handle && handle.promise().continuation.load(std::memory_order_acquire) == finishedMarker();
+		}
+
+		//only valid after the task finished
+		decltype(auto) getResult() {
+			return handle.promise().get();
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle = nullptr;
+
+		explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+		static void* finishedMarker() {
+			static char marker;
+			return &marker;
+		}
+
+		void destroy() {
+			if (handle) {
+				handle.destroy();
+				handle = nullptr;
+			}
+		}
+	};
+
+}
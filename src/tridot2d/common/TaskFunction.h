@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tridot2d {
+
+	//move only void() callable for tasks
+	//callables up to bufferSize bytes are stored inline, only larger ones are allocated
+	class TaskFunction {
+	public:
+		static constexpr size_t bufferSize = 48;
+
+		TaskFunction() {}
+		TaskFunction(std::nullptr_t) {}
+
+		TaskFunction(const std::function<void()>& function) {
+			if (function) {
+				set(function);
+			}
+		}
+
+		TaskFunction(std::function<void()>&& function) {
+			if (function) {
+				set(std::move(function));
+			}
+		}
+
+		template<typename Function, typename = std::enable_if_t<
+			!std::is_same_v<std::decay_t<Function>, TaskFunction> &&
+			!std::is_same_v<std::decay_t<Function>, std::function<void()>>>>
+		TaskFunction(Function&& function) {
+			set(std::forward<Function>(function));
+		}
+
+		TaskFunction(TaskFunction&& function) noexcept {
+			moveFrom(function);
+		}
+
+		TaskFunction& operator=(TaskFunction&& function) noexcept {
+			if (this != &function) {
+				reset();
+				moveFrom(function);
+			}
+			return *this;
+		}
+
+		TaskFunction& operator=(std::nullptr_t) {
+			reset();
+			return *this;
+		}
+
+		TaskFunction(const TaskFunction&) = delete;
+		TaskFunction& operator=(const TaskFunction&) = delete;
+
+		~TaskFunction() {
+			reset();
+		}
+
+		void operator()() {
+			operations->invoke(buffer);
+		}
+
+		explicit operator bool() const {
+			return operations != nullptr;
+		}
+
+		template<typename Function>
+		static constexpr bool isStoredInline() {
+			return sizeof(Function) <= bufferSize && alignof(Function) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Function>;
+		}
+
+	private:
+		class Operations {
+		public:
+			void (*invoke)(void* buffer);
+			//moves the callable into an uninitialized buffer and destroys the source
+			void (*move)(void* from, void* to);
+			void (*destroy)(void* buffer);
+		};
+
+		template<typename Function>
+		static inline const Operations inlineOperations = {
+			[](void* buffer) {
+				(*(Function*)buffer)();
+			},
+			[](void* from, void* to) {
+				new (to) Function(std::move(*(Function*)from));
+				((Function*)from)->~Function();
+			},
+			[](void* buffer) {
+				((Function*)buffer)->~Function();
+			},
+		};
+
+		template<typename Function>
+		static inline const Operations allocatedOperations = {
+			[](void* buffer) {
+				(**(Function**)buffer)();
+			},
+			[](void* from, void* to) {
+				*(Function**)to = *(Function**)from;
+			},
+			[](void* buffer) {
+				delete *(Function**)buffer;
+			},
+		};
+
+		alignas(std::max_align_t) unsigned char buffer[bufferSize];
+		const Operations* operations = nullptr;
+
+		template<typename Function>
+		void set(Function&& function) {
+			typedef std::decay_t<Function> Type;
+			if constexpr (isStoredInline<Type>()) {
+				new (buffer) Type(std::forward<Function>(function));
+				operations = &inlineOperations<Type>;
+			}
+			else {
+				*(Type**)buffer = new Type(std::forward<Function>(function));
+				operations = &allocatedOperations<Type>;
+			}
+		}
+
+		void moveFrom(TaskFunction& function) {
+			if (function.operations) {
+				function.operations->move(function.buffer, buffer);
+				operations = function.operations;
+				function.operations = nullptr;
+			}
+		}
+
+		void reset() {
+			if (operations) {
+				operations->destroy(buffer);
+				operations = nullptr;
+			}
+		}
+	};
+
+}
@@ -0,0 +1,261 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "TaskManager.h"
+#include "Log.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace tridot2d {
+
+	template<typename T>
+	class TaskFutureState {
+	public:
+		typedef std::conditional_t<std::is_void_v<T>, bool, T> Value;
+
+		TaskManager* taskManager = nullptr;
+		//lowest priority of the tasks that lead to the value, waiting threads only help with tasks of at least this priority
+		TaskPriority priority = TaskPriority::LOW;
+		std::atomic<bool> ready = false;
+		//the task was terminated before it set the value, ready is set without a value
+		bool failed = false;
+		std::optional<Value> value;
+		//run on the thread that sets the value, guarded by mutex
+		std::vector<TaskFunction> continuations;
+		std::mutex mutex;
+
+		template<typename... Args>
+		void setValue(Args&&... args) {
+			std::unique_lock<std::mutex> lock(mutex);
+			value.emplace(std::forward<Args>(args)...);
+			setReady(lock);
+		}
+
+		void setFailed() {
+			std::unique_lock<std::mutex> lock(mutex);
+			failed = true;
+			setReady(lock);
+		}
+
+		//the continuations are removed before they run, so they don't keep other states alive
+		void setReady(std::unique_lock<std::mutex>& lock) {
+			std::vector<TaskFunction> pending;
+			ready.store(true, std::memory_order_release);
+			pending.swap(continuations);
+			lock.unlock();
+			for (auto& continuation : pending) {
+				continuation();
+			}
+		}
+
+		//runs the continuation right away if the value is already set
+		void addContinuation(TaskFunction&& continuation) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (!ready.load(std::memory_order_relaxed)) {
+					continuations.push_back(std::move(continuation));
+					return;
+				}
+			}
+			continuation();
+		}
+	};
+
+	//owned by the task that sets the value, marks the state as failed when destroyed before the value is set
+	//this happens when the task is terminated or the task manager is destroyed with the task still pending
+	template<typename T>
+	class TaskFuturePromise {
+	public:
+		std::shared_ptr<TaskFutureState<T>> state;
+
+		TaskFuturePromise(const std::shared_ptr<TaskFutureState<T>>& state) : state(state) {}
+		TaskFuturePromise(TaskFuturePromise&& promise) = default;
+
+		~TaskFuturePromise() {
+			if (state && !state->ready.load(std::memory_order_acquire)) {
+				state->setFailed();
+			}
+		}
+	};
+
+	template<typename Function, typename T>
+	class ContinuationResult {
+	public:
+		typedef std::invoke_result_t<Function, T&> type;
+	};
+
+	template<typename Function>
+	class ContinuationResult<Function, void> {
+	public:
+		typedef std::invoke_result_t<Function> type;
+	};
+
+	//result of a task added with TaskManager::submit, copies refer to the same result
+	//a future of a terminated task becomes ready without a result, see isFailed
+	template<typename T>
+	class TaskFuture {
+	public:
+		std::shared_ptr<TaskFutureState<T>> state;
+		uint64_t taskId = 0;
+
+		bool isValid() const {
+			return state != nullptr;
+		}
+
+		bool isReady() const {
+			return state && state->ready.load(std::memory_order_acquire);
+		}
+
+		//the task was terminated before it set the result, get must not be called then
+		bool isFailed() const {
+			return isReady() && state->failed;
+		}
+
+		//waits until the result is set, the calling thread executes pending tasks while waiting
+		void wait() const {
+			if (!isReady()) {
+				auto* futureState = state.get();
+				futureState->taskManager->waitUntil([futureState]() {
+					return futureState->ready.load(std::memory_order_acquire);
+				}, futureState->priority);
+			}
+		}
+
+		//waits for the result, the result stays in the future and can be read again by every copy of the future
+		decltype(auto) get() const {
+			wait();
+			if (state->failed) {
+				Log::error("the result of a terminated task was requested");
+				std::terminate();
+			}
+			if constexpr (!std::is_void_v<T>) {
+				return static_cast<const T&>(*state->value);
+			}
+		}
+
+		//adds a task that runs function with the result once it is set
+		//the returned future fails without running function when this future fails
+		template<typename Function>
+		auto then(Function&& function, TaskPriority priority = TaskPriority::NORMAL) const {
+			typedef typename ContinuationResult<std::decay_t<Function>&, T>::type R;
+			TaskFuture<R> future;
+			future.state = std::make_shared<TaskFutureState<R>>();
+			future.state->taskManager = state->taskManager;
+			future.state->priority = std::max(priority, state->priority);
+			//the continuation is stored in the source, so it only holds a weak reference to it
+			state->addContinuation([source = std::weak_ptr<TaskFutureState<T>>(state), target = TaskFuturePromise<R>(future.state), function = std::forward<Function>(function), priority]() mutable {
+				//the source is alive while it runs its continuations
+				std::shared_ptr<TaskFutureState<T>> sourceState = source.lock();
+				if (sourceState->failed) {
+					target.state->setFailed();
+					return;
+				}
+				sourceState->taskManager->addTask([sourceState, target = std::move(target), function = std::move(function)]() mutable {
+					if constexpr (std::is_void_v<T>) {
+						setResult(*target.state, function);
+					}
+					else {
+						setResult(*target.state, function, *sourceState->value);
+					}
+				}, priority);
+			});
+			return future;
+		}
+
+		//runs function and stores its result in state
+		template<typename R, typename Function, typename... Args>
+		static void setResult(TaskFutureState<R>& state, Function& function, Args&... args) {
+			if constexpr (std::is_void_v<R>) {
+				function(args...);
+				state.setValue(true);
+			}
+			else {
+				state.setValue(function(args...));
+			}
+		}
+	};
+
+	template<typename Function>
+	TaskFuture<std::invoke_result_t<std::decay_t<Function>&>> TaskManager::submit(Function&& function, TaskPriority priority) {
+		typedef std::invoke_result_t<std::decay_t<Function>&> R;
+		TaskFuture<R> future;
+		future.state = std::make_shared<TaskFutureState<R>>();
+		future.state->taskManager = this;
+		future.state->priority = priority;
+		future.taskId = addTask([promise = TaskFuturePromise<R>(future.state), function = std::forward<Function>(function)]() mutable {
+			TaskFuture<R>::setResult(*promise.state, function);
+		}, priority);
+		return future;
+	}
+
+	//becomes ready when all futures are ready, the results stay in the futures
+	//fails when one of the futures failed
+	template<typename T>
+	TaskFuture<void> whenAll(const std::vector<TaskFuture<T>>& futures) {
+		TaskFuture<void> result;
+		result.state = std::make_shared<TaskFutureState<void>>();
+		if (futures.empty()) {
+			result.state->setValue(true);
+			return result;
+		}
+		result.state->taskManager = futures[0].state->taskManager;
+		result.state->priority = TaskPriority::HIGH;
+		for (auto& future : futures) {
+			result.state->priority = std::max(result.state->priority, future.state->priority);
+		}
+
+		auto remaining = std::make_shared<std::atomic<int>>((int)futures.size());
+		auto failed = std::make_shared<std::atomic<bool>>(false);
+		for (auto& future : futures) {
+			future.state->addContinuation([remaining, failed, source = future.state.get(), state = result.state]() {
+				if (source->failed) {
+					failed->store(true, std::memory_order_relaxed);
+				}
+				if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					if (failed->load(std::memory_order_relaxed)) {
+						state->setFailed();
+					}
+					else {
+						state->setValue(true);
+					}
+				}
+			});
+		}
+		return result;
+	}
+
+	//becomes ready when the first future is ready, the result is the index of that future
+	//the future at that index may have failed
+	template<typename T>
+	TaskFuture<int> whenAny(const std::vector<TaskFuture<T>>& futures) {
+		TaskFuture<int> result;
+		result.state = std::make_shared<TaskFutureState<int>>();
+		if (futures.empty()) {
+			result.state->setValue(-1);
+			return result;
+		}
+		result.state->taskManager = futures[0].state->taskManager;
+		result.state->priority = TaskPriority::HIGH;
+		for (auto& future : futures) {
+			result.state->priority = std::max(result.state->priority, future.state->priority);
+		}
+
+		auto done = std::make_shared<std::atomic<bool>>(false);
+		for (int i = 0; i < (int)futures.size(); i++) {
+			futures[i].state->addContinuation([done, i, state = result.state]() {
+				if (!done->exchange(true, std::memory_order_acq_rel)) {
+					state->setValue(i);
+				}
+			});
+		}
+		return result;
+	}
+
+}
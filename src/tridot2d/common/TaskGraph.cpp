@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "TaskGraph.h"
+#include "TaskManager.h"
+#include "Log.h"
+
+namespace tridot2d {
+
+	int TaskGraph::addNode(const std::function<void()>& callback, const std::string& name) {
+		auto node = std::make_unique<Node>();
+		node->name = name;
+		node->callback = callback;
+		nodes.push_back(std::move(node));
+		compiled = false;
+		return (int)nodes.size() - 1;
+	}
+
+	void TaskGraph::addDependency(int node, int dependency) {
+		if (node < 0 || node >= nodes.size() || dependency < 0 || dependency >= nodes.size()) {
+			return;
+		}
+		nodes[dependency]->successors.push_back(node);
+		nodes[node]->dependencyCount++;
+		compiled = false;
+	}
+
+	int TaskGraph::addContinuation(int node, const std::function<void()>& callback, const std::string& name) {
+		int continuation = addNode(callback, name);
+		addDependency(continuation, node);
+		return continuation;
+	}
+
+	void TaskGraph::clear() {
+		wait();
+		nodes.clear();
+		roots.clear();
+		compiled = false;
+	}
+
+	bool TaskGraph::compile() {
+		if (compiled) {
+			return valid;
+		}
+		compiled = true;
+
+		roots.clear();
+		for (int i = 0; i < nodes.size(); i++) {
+			if (nodes[i]->dependencyCount == 0) {
+				roots.push_back(i);
+			}
+		}
+
+		//every node has to be reachable by releasing dependencies, otherwise there is a cycle
+		std::vector<int> dependencies(nodes.size());
+		std::vector<int> ready = roots;
+		for (int i = 0; i < nodes.size(); i++) {
+			dependencies[i] = nodes[i]->dependencyCount;
+		}
+		int visited = 0;
+		while (!ready.empty()) {
+			int index = ready.back();
+			ready.pop_back();
+			visited++;
+			for (int successor : nodes[index]->successors) {
+				if (--dependencies[successor] == 0) {
+					ready.push_back(successor);
+				}
+			}
+		}
+
+		valid = visited == nodes.size();
+		if (!valid) {
+			Log::error("task graph has a cycle, %d of %d nodes are part of it or depend on it", (int)nodes.size() - visited, (int)nodes.size());
+		}
+		return valid;
+	}
+
+	void TaskGraph::start(TaskManager* taskManager) {
+		wait();
+		if (!compile() || nodes.empty()) {
+			return;
+		}
+		this->taskManager = taskManager;
+
+		for (auto& node : nodes) {
+			node->pendingDependencies.store(node->dependencyCount, std::memory_order_relaxed);
+		}
+		remainingNodes.store((int)nodes.size(), std::memory_order_release);
+
+		for (int root : roots) {
+			scheduleNode(root);
+		}
+	}
+
+	void TaskGraph::wait() {
+		if (taskManager && !isFinished()) {
+			taskManager->waitUntil([this]() {
+				return isFinished();
+			});
+		}
+	}
+
+	void TaskGraph::run(TaskManager* taskManager) {
+		start(taskManager);
+		wait();
+	}
+
+	bool TaskGraph::isFinished() {
+		return remainingNodes.load(std::memory_order_acquire) == 0;
+	}
+
+	int TaskGraph::getNodeCount() {
+		return (int)nodes.size();
+	}
+
+	const std::string& TaskGraph::getNodeName(int node) {
+		static const std::string empty;
+		if (node < 0 || node >= nodes.size()) {
+			return empty;
+		}
+		return nodes[node]->name;
+	}
+
+	void TaskGraph::runNode(int index) {
+		while (index >= 0) {
+			Node* node = nodes[index].get();
+			if (node->callback) {
+				node->callback();
+			}
+
+			//the first successor that becomes ready runs on this thread as a continuation, the others are scheduled
+			int next = -1;
+			for (int successor : node->successors) {
+				if (nodes[successor]->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					if (next == -1) {
+						next = successor;
+					}
+					else {
+						scheduleNode(successor);
+					}
+				}
+			}
+			remainingNodes.fetch_sub(1, std::memory_order_acq_rel);
+			index = next;
+		}
+	}
+
+	void TaskGraph::scheduleNode(int index) {
+		if (taskManager) {
+			//setting a task name takes a lock, so names are only passed when they are used
+			static const std::string noName;
+			taskManager->addTask([this, index]() {
+				runNode(index);
+			}, TaskType::NORMAL, taskManager->isProfiling() ? nodes[index]->name : noName);
+		}
+		else {
+			runNode(index);
+		}
+	}
+
+}
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+namespace tridot2d {
+
+	class TaskManager;
+
+	//directed acyclic graph of tasks that can be run many times, e.g. once per frame
+	//a node is scheduled on the task manager as soon as all nodes it depends on finished
+	//running an unchanged graph again does not allocate memory
+	class TaskGraph {
+	public:
+		//returns the index of the node, the name is given to the task of the node while the task manager is profiling
+		int addNode(const std::function<void()>& callback, const std::string& name = "");
+		//node runs after dependency finished
+		void addDependency(int node, int dependency);
+		//adds a node that runs after node finished
+		int addContinuation(int node, const std::function<void()>& callback, const std::string& name = "");
+		void clear();
+
+		//checks the graph for cycles, called by start if the graph changed
+		bool compile();
+
+		//starts all nodes without dependencies, the graph must not be started again before it finished
+		//without a task manager all nodes run on the calling thread before start returns
+		void start(TaskManager* taskManager);
+		//waits until all nodes finished, the calling thread executes pending tasks while waiting
+		void wait();
+		//start and wait
+		void run(TaskManager* taskManager);
+		bool isFinished();
+
+		int getNodeCount();
+		const std::string& getNodeName(int node);
+
+	private:
+		class Node {
+		public:
+			std::string name;
+			std::function<void()> callback;
+			std::vector<int> successors;
+			int dependencyCount = 0;
+			std::atomic<int> pendingDependencies = 0;
+		};
+
+		std::vector<std::unique_ptr<Node>> nodes;
+		std::vector<int> roots;
+		bool compiled = false;
+		bool valid = false;
+		TaskManager* taskManager = nullptr;
+		std::atomic<int> remainingNodes = 0;
+
+		void runNode(int index);
+		void scheduleNode(int index);
+	};
+
+}
@@ -5,6 +5,13 @@
 #include "TaskManager.h"
 #include "util/Clock.h"
 #include "util/strutil.h"
+#include "Log.h"
+#include <fstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #define LOCK(mutexName) std::unique_lock<std::mutex> lock_##mutexName(mutexName);
 
@@ -12,31 +19,112 @@ namespace tridot2d {
 
 	thread_local TaskManager::Thread* TaskManager::currentThread = nullptr;
 
-	int TaskManager::addTask(const std::function<void()>& callback, TaskType type, const std::string& name, uint64_t delayMillis, void* owner, bool singleThreading) {
-		int id = 0;
+	//tries to find a task a few times before a worker goes to sleep
+	static constexpr int idleSpinCount = 64;
+	//chunks per thread when parallelFor chooses the grain size, more chunks balance uneven work better
+	static constexpr int chunksPerThread = 4;
+	static constexpr int maxParallelTasks = 64;
+
+	TaskManager::~TaskManager() {
+		stop();
+		for (int i = 0; i < taskBlockCount; i++) {
+			delete[] taskBlocks[i].load();
+		}
+		delete queues.load();
+	}
+
+	uint64_t TaskManager::addTask(TaskFunction&& callback, TaskType type, const std::string& name, uint64_t delayMillis, void* owner, bool singleThreading, TaskPriority priority, uint64_t deadlineMillis) {
+		Task* task = createTask(std::move(callback), type, name, delayMillis, owner, singleThreading, priority, deadlineMillis);
+		//the task might be finished and reused as soon as it is scheduled
+		uint64_t id = task->taskId.load(std::memory_order_relaxed);
+		scheduleTask(task);
+		return id;
+	}
+
+	uint64_t TaskManager::addQueueTask(int queueId, TaskFunction&& callback, const std::string& name, uint64_t delayMillis) {
+		if (queueId < 0 || queueId >= namedQueueCount.load(std::memory_order_acquire)) {
+			Log::error("task queue %d does not exist", queueId);
+			return 0;
+		}
+		Task* task = createTask(std::move(callback), delayMillis > 0 ? TaskType::DELAYED : TaskType::NORMAL, name, delayMillis, nullptr, false, TaskPriority::NORMAL, 0);
+		task->queueId = queueId;
+		uint64_t id = task->taskId.load(std::memory_order_relaxed);
+		scheduleTask(task);
+		return id;
+	}
+
+	int TaskManager::getQueue(const std::string& name) {
+		LOCK(namedQueueMutex);
+		int count = namedQueueCount.load(std::memory_order_relaxed);
+		for (int i = 0; i < count; i++) {
+			if (namedQueues[i].name == name) {
+				return i;
+			}
+		}
+		if (count >= maxNamedQueues) {
+			Log::error("can not create task queue %s, there are already %d queues", name.c_str(), maxNamedQueues);
+			return -1;
+		}
+		namedQueues[count].name = name;
+		namedQueueCount.store(count + 1, std::memory_order_release);
+		return count;
+	}
+
+	int TaskManager::runQueue(int queueId) {
+		if (queueId < 0 || queueId >= namedQueueCount.load(std::memory_order_acquire)) {
+			return 0;
+		}
+		NamedQueue& queue = namedQueues[queueId];
+
+		//tasks added while running are left for the next call, so a task adding itself again does not block the thread
+		int count = 0;
 		{
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			count = (int)queue.tasks.size();
+		}
+		int executed = 0;
+		for (; executed < count; executed++) {
+			Task* task = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				if (queue.tasks.empty()) {
+					break;
+				}
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			executeTask(task);
+		}
+		return executed;
+	}
+
+	TaskManager::Task* TaskManager::createTask(TaskFunction&& callback, TaskType type, const std::string& name, uint64_t delayMillis, void* owner, bool singleThreading, TaskPriority priority, uint64_t deadlineMillis) {
+		Task* task = allocateTask();
+		if (!name.empty() || !task->name.empty()) {
 			LOCK(taskDataMutex);
-			id = nextTaskId++;
-
-			Task task;
-			task.taskId = id;
-			task.name = name;
-			task.createTime = Clock::nowMilli();
-			task.startTime = task.createTime + delayMillis;
-			task.reccuringInterval = delayMillis;
-			task.type = type;
-			task.owner = owner;
-			task.singleThreading = singleThreading;
-			task.callback = callback;
-			task.state = TaskState::CREATED;
-			tasks[id] = task;
-		}
-		scheduleTask(id);
-		removeFinishedTasks();
-		return id;
+			task->name = name;
+		}
+		if (type == TaskType::DELAYED || type == TaskType::RECURRING || deadlineMillis > 0 || isProfiling()) {
+			task->createTime = Clock::nowNano();
+			task->startTime = task->createTime + delayMillis * 1000000;
+			task->reccuringInterval = delayMillis * 1000000;
+		}
+		else {
+			task->createTime = 0;
+		}
+		task->deadline = deadlineMillis * 1000000;
+		task->priority = priority;
+		task->type.store(type, std::memory_order_relaxed);
+		task->owner.store(owner, std::memory_order_relaxed);
+		task->singleThreading = singleThreading;
+		task->queueId = -1;
+		task->callback = std::move(callback);
+		task->state.store(TaskState::CREATED, std::memory_order_relaxed);
+		task->taskId.store((task->generation << slotBits) | (uint64_t)task->slotIndex, std::memory_order_release);
+		return task;
 	}
 
-	int TaskManager::getCurrentTaskId() {
+	uint64_t TaskManager::getCurrentTaskId() {
 		if (currentThread) {
 			return currentThread->taskId;
 		}
@@ -45,53 +133,111 @@ namespace tridot2d {
 		}
 	}
 
-	void TaskManager::joinTask(int taskId) {
-		std::unique_lock<std::mutex> lock(taskDataMutex);
-		Task& task = getTask(taskId);
-		while (task.state != TaskState::FINIESHED && task.state != TaskState::TERMINATED) {
+	void TaskManager::joinTask(uint64_t taskId) {
+		Task* task = getTask(taskId);
+		if (!task) {
+			//finished tasks are removed
+			return;
+		}
+
+		bool stopped = false;
+		TaskPriority priority = task->priority;
+		waitUntil([&]() {
+			if (task->taskId.load(std::memory_order_acquire) != taskId) {
+				return true;
+			}
+			TaskState state = task->state.load(std::memory_order_acquire);
+			if (state == TaskState::FINIESHED || state == TaskState::TERMINATED) {
+				return true;
+			}
 
 			//stop reccuring task on join
-			if (task.type == RECURRING) {
-				task.type = TaskType::DELAYED;
-				if (!(task.state == TaskState::RUNNING || task.state == TaskState::PAUSED)) {
-					task.state = TaskState::FINIESHED;
-					break;
+			TaskType recurring = TaskType::RECURRING;
+			if (task->type.compare_exchange_strong(recurring, TaskType::DELAYED)) {
+				TaskState waiting = TaskState::WAITING;
+				if (task->state.compare_exchange_strong(waiting, TaskState::FINIESHED)) {
+					cancelWaitingTask(task);
+					stopped = true;
+					return true;
 				}
 			}
+			return false;
+		}, priority);
+		if (stopped) {
+			notifyTaskFinished();
+		}
+	}
 
-			//run joining task on thread if it would lock up another task
-			int currentTaskId = getCurrentTaskId();
-			if (currentTaskId != 0) {
-				Task& currentTask = getTask(currentTaskId);
-				if (task.state == TaskState::SCHEDULED && currentTask.state == TaskState::RUNNING) {
-					currentTask.state = TaskState::PAUSED;
-					lock.unlock();
-					runTask(taskId);
-					lock.lock();
-					currentThread->taskId = currentTaskId;
-					currentTask.state = TaskState::RUNNING;
-					continue;
+	void TaskManager::helpUntil(bool (*isDone)(void* context), void* context, TaskPriority priority) {
+		TaskQueue* ownQueues = getCurrentQueues();
+		while (!isDone(context)) {
+			//run other tasks while waiting, this also runs a joined task if it is still pending
+			//the starvation rule is not used here, so a waiting thread doesn't run long background work
+			//lower priorities are left to the workers, without workers nobody else would run them
+			int lowest = startedWorkers.load(std::memory_order_relaxed) > 0 ? (int)priority : priorityCount - 1;
+			Task* next = nullptr;
+			for (int i = 0; !next && i <= lowest; i++) {
+				next = findTask(ownQueues, i);
+			}
+			if (next) {
+				Task* currentTask = getTask(getCurrentTaskId());
+				TaskState running = TaskState::RUNNING;
+				bool paused = currentTask && currentTask->state.compare_exchange_strong(running, TaskState::PAUSED);
+				executeTask(next);
+				TaskState pausedState = TaskState::PAUSED;
+				if (paused) {
+					currentTask->state.compare_exchange_strong(pausedState, TaskState::RUNNING);
 				}
+				continue;
 			}
 
-			taskFinished.wait(lock);
+			joiningThreads.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			{
+				LOCK(sleepMutex);
+				if (!isDone(context) && !hasPendingTasks(lowest)) {
+					taskFinished.wait(lock_sleepMutex);
+				}
+			}
+			joiningThreads.fetch_sub(1);
 		}
 	}
 
 	void TaskManager::joinTasksByOwner(void* owner) {
-		for (auto& i : tasks) {
-			Task& task = i.second;
-			if (task.owner == owner) {
-				joinTask(task.taskId);
+		std::vector<uint64_t> ids;
+		for (int i = 0; i < taskBlockCount; i++) {
+			Task* block = taskBlocks[i].load(std::memory_order_acquire);
+			for (int j = 0; j < taskBlockSize; j++) {
+				uint64_t id = block[j].taskId.load(std::memory_order_acquire);
+				if (id != 0 && block[j].owner.load(std::memory_order_relaxed) == owner) {
+					ids.push_back(id);
+				}
 			}
 		}
+		for (uint64_t id : ids) {
+			joinTask(id);
+		}
 	}
 
-	void TaskManager::terminateTask(int taskId) {
-		std::unique_lock<std::mutex> lock(taskDataMutex);
-		Task& task = getTask(taskId);
+	void TaskManager::terminateTask(uint64_t taskId) {
+		Task* task = getTask(taskId);
+		if (!task) {
+			return;
+		}
 
-		if (task.state == TaskState::RUNNING || task.state == TaskState::PAUSED) {
+		//pending tasks are released by the thread that dequeues them
+		for (TaskState pending : { TaskState::CREATED, TaskState::WAITING, TaskState::SCHEDULED }) {
+			if (task->state.compare_exchange_strong(pending, TaskState::TERMINATED)) {
+				if (pending == TaskState::WAITING) {
+					cancelWaitingTask(task);
+				}
+				notifyTaskFinished();
+				return;
+			}
+		}
+
+		TaskState state = task->state.load();
+		if (state == TaskState::RUNNING || state == TaskState::PAUSED) {
 			std::unique_lock<std::mutex> threadLock(threadDataMutex);
 
 			for (auto& thread : threads) {
@@ -101,46 +247,70 @@ namespace tridot2d {
 						threadLock.unlock();
 						addThread([&]() {
 							runWorker();
-						}, thread->name);
+						}, thread->name, true);
 						break;
 					}
 				}
 			}
 		}
-		if (task.state != TaskState::FINIESHED) {
-			task.state = TaskState::TERMINATED;
+		//the thread finishing the task releases it
+		state = task->state.load();
+		while (task->taskId.load() == taskId && (state == TaskState::RUNNING || state == TaskState::PAUSED)) {
+			if (task->state.compare_exchange_weak(state, TaskState::TERMINATED)) {
+				notifyTaskFinished();
+				break;
+			}
 		}
 	}
 
-	void TaskManager::start(int workerCount) {
+	void TaskManager::start(int workerCount, bool pinWorkers) {
 		stop();
 		currentThread = &defaultThread;
+		defaultThread.taskManager = this;
+		defaultThread.queues = std::make_unique<TaskQueue[]>(priorityCount);
+		{
+			LOCK(threadDataMutex);
+			addQueues(defaultThread.queues.get());
+		}
 
+		int cpuCount = (int)std::thread::hardware_concurrency();
 		for (int i = 0; i < workerCount; i++) {
-			addThread([&]() {
+			int threadId = addThread([&]() {
 				runWorker();
-			}, "worker_" + toString(i));
+			}, "worker_" + toString(i), true);
+			if (pinWorkers && cpuCount > 0) {
+				//cpu 0 is left to the main thread as long as there are enough cpus
+				setThreadAffinity(threadId, (i + 1) % cpuCount);
+			}
 		}
+		startedWorkers = workerCount;
 		addThread([&]() {
 			runTimer();
 		}, "timer");
 	}
 
 	void TaskManager::stop(bool joinTasks, bool runAllTasks) {
-		LOCK(threadDataMutex);
-
 		if (runAllTasks) {
-			for (auto& i : tasks) {
-				joinTask(i.first);
+			for (uint64_t id : getTaskIds()) {
+				joinTask(id);
 			}
 		}
 
+		LOCK(threadDataMutex);
+
+		startedWorkers = 0;
 		for (auto& thread : threads) {
 			thread->running = false;
 		}
-		wakeupWorker.notify_all();
-		wakeupTimer.notify_all();
-
+		{
+			LOCK(sleepMutex);
+			wakeupWorker.notify_all();
+			taskFinished.notify_all();
+		}
+		{
+			LOCK(timerMutex);
+			wakeupTimer.notify_all();
+		}
 
 		for (auto& thread : threads) {
 			if (joinTasks) {
@@ -148,23 +318,118 @@ namespace tridot2d {
 			}
 			else {
 				thread->terminate();
-				if (thread->taskId != 0) {
-					getTask(thread->taskId).state = TaskState::TERMINATED;
+				if (Task* task = getTask(thread->taskId)) {
+					task->state = TaskState::TERMINATED;
+				}
+			}
+		}
+
+		//pending tasks are kept for the next start
+		if (auto* list = queues.load()) {
+			LOCK(sharedTaskMutex);
+			for (auto* threadQueues : *list) {
+				for (int priority = 0; priority < priorityCount; priority++) {
+					TaskQueue& queue = threadQueues[priority];
+					Task* task = nullptr;
+					while (!queue.empty()) {
+						if (queue.steal(task)) {
+							sharedTasks[priority].push_back(task);
+							sharedTaskCount++;
+						}
+					}
 				}
 			}
 		}
+		if (auto* list = queues.exchange(nullptr)) {
+			queueLists.push_back(std::unique_ptr<std::vector<TaskQueue*>>(list));
+		}
+
 		threads.clear();
+		if (currentThread == &defaultThread) {
+			currentThread = nullptr;
+		}
+		defaultThread.queues = nullptr;
+	}
+
+	TaskManager::Task* TaskManager::getTask(uint64_t taskId) {
+		if (taskId == 0) {
+			return nullptr;
+		}
+		Task* task = getTaskSlot((int)(taskId & slotMask));
+		if (!task || task->taskId.load(std::memory_order_acquire) != taskId) {
+			return nullptr;
+		}
+		return task;
 	}
 
-	TaskManager::Task& TaskManager::getTask(int taskId) {
-		auto i = tasks.find(taskId);
-		if (i == tasks.end()) {
-			return defaultTask;
+	TaskManager::Task* TaskManager::getTaskSlot(int slotIndex) {
+		Task* block = taskBlocks[slotIndex >> taskBlockBits].load(std::memory_order_acquire);
+		if (!block) {
+			return nullptr;
 		}
-		return i->second;
+		return &block[slotIndex & (taskBlockSize - 1)];
 	}
 
-	int TaskManager::addThread(const std::function<void()>& callback, const std::string& name) {
+	TaskManager::Task* TaskManager::allocateTask() {
+		while (true) {
+			uint64_t head = freeTasks.load(std::memory_order_acquire);
+			while ((uint32_t)head != 0) {
+				Task* task = getTaskSlot((uint32_t)head - 1);
+				uint64_t next = (((head >> 32) + 1) << 32) | (uint32_t)(task->nextFree.load(std::memory_order_relaxed) + 1);
+				if (freeTasks.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+					task->generation = task->generation % maxGeneration + 1;
+					return task;
+				}
+			}
+
+			LOCK(taskDataMutex);
+			if ((uint32_t)freeTasks.load() != 0) {
+				continue;
+			}
+			int blockIndex = taskBlockCount;
+			if (blockIndex >= maxTaskBlocks) {
+				//all slots are in use, wait for tasks to finish
+				lock_taskDataMutex.unlock();
+				std::this_thread::yield();
+				continue;
+			}
+
+			Task* block = new Task[taskBlockSize];
+			int base = blockIndex * taskBlockSize;
+			for (int i = 0; i < taskBlockSize; i++) {
+				block[i].slotIndex = base + i;
+				block[i].nextFree = base + i + 1;
+			}
+			taskBlocks[blockIndex].store(block, std::memory_order_release);
+			taskBlockCount.store(blockIndex + 1, std::memory_order_release);
+
+			//the first slot is returned, the others are pushed to the free list
+			Task* last = &block[taskBlockSize - 1];
+			head = freeTasks.load(std::memory_order_relaxed);
+			uint64_t next = 0;
+			do {
+				last->nextFree.store((int)(uint32_t)head - 1, std::memory_order_relaxed);
+				next = (((head >> 32) + 1) << 32) | (uint32_t)(base + 2);
+			} while (!freeTasks.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+
+			block[0].generation = 1;
+			return &block[0];
+		}
+	}
+
+	void TaskManager::releaseTask(Task* task) {
+		task->callback = nullptr;
+		task->taskId.store(0, std::memory_order_release);
+
+		uint64_t head = freeTasks.load(std::memory_order_relaxed);
+		uint64_t next = 0;
+		do {
+			task->nextFree.store((int)(uint32_t)head - 1, std::memory_order_relaxed);
+			next = (((head >> 32) + 1) << 32) | (uint32_t)(task->slotIndex + 1);
+		} while (!freeTasks.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	int TaskManager::addThread(const std::function<void()>& callback, const std::string& name, bool isWorker) {
 		LOCK(threadDataMutex);
 		int id = nextThreadId++;
 
@@ -173,6 +438,12 @@ namespace tridot2d {
 		thread->name = name;
 		thread->state = ThreadState::CREATED;
 		thread->running = true;
+		thread->isWorker = isWorker;
+		thread->taskManager = this;
+		if (isWorker) {
+			thread->queues = std::make_unique<TaskQueue[]>(priorityCount);
+			addQueues(thread->queues.get());
+		}
 		thread->thread = new std::thread([thread, callback]() {
 			currentThread = thread.get();
 			thread->state = ThreadState::WAIT_FOR_TASK;
@@ -188,145 +459,536 @@ namespace tridot2d {
 		return id;
 	}
 
-	void TaskManager::runTask(int taskId) {
-		std::unique_lock<std::mutex> lock(taskDataMutex);
-		Task& task = getTask(taskId);
-		task.state = TaskState::RUNNING;
+	void TaskManager::addQueues(TaskQueue* threadQueues) {
+		//thieves might still iterate over the previous list, so it is kept until the task manager is destroyed
+		auto* previous = queues.load();
+		auto* list = previous ? new std::vector<TaskQueue*>(*previous) : new std::vector<TaskQueue*>();
+		list->push_back(threadQueues);
+		queues.store(list, std::memory_order_release);
+		if (previous) {
+			queueLists.push_back(std::unique_ptr<std::vector<TaskQueue*>>(previous));
+		}
+	}
+
+	TaskManager::TaskQueue* TaskManager::getCurrentQueues() {
+		if (currentThread && currentThread->taskManager == this) {
+			return currentThread->queues.get();
+		}
+		return nullptr;
+	}
+
+	void TaskManager::pushTask(Task* task) {
+		if (task->queueId >= 0) {
+			NamedQueue& queue = namedQueues[task->queueId];
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(task);
+			return;
+		}
+		if (TaskQueue* ownQueues = getCurrentQueues()) {
+			ownQueues[(int)task->priority].push(task);
+		}
+		else {
+			LOCK(sharedTaskMutex);
+			pushSharedTask(task);
+		}
+		wakeupWorkers();
+	}
+
+	void TaskManager::pushSharedTask(Task* task) {
+		sharedTasks[(int)task->priority].push_back(task);
+		sharedTaskCount++;
+	}
+
+	TaskManager::Task* TaskManager::findTask() {
+		TaskQueue* ownQueues = getCurrentQueues();
+
+		//every starvationInterval picks the search starts at NORMAL or LOW in turns, then continues from HIGH
+		static thread_local uint32_t pickCount = 0;
+		int first = 0;
+		if (pickCount % starvationInterval == starvationInterval - 1) {
+			first = (pickCount / starvationInterval) % 2 == 0 ? (int)TaskPriority::LOW : (int)TaskPriority::NORMAL;
+		}
+
+		Task* task = findTask(ownQueues, first);
+		for (int priority = 0; !task && priority < priorityCount; priority++) {
+			if (priority != first) {
+				task = findTask(ownQueues, priority);
+			}
+		}
+		if (task) {
+			pickCount++;
+		}
+		return task;
+	}
+
+	TaskManager::Task* TaskManager::findTask(TaskQueue* ownQueues, int priority) {
+		Task* task = nullptr;
+		if (ownQueues && ownQueues[priority].pop(task)) {
+			return task;
+		}
+
+		if (sharedTaskCount.load(std::memory_order_relaxed) > 0) {
+			LOCK(sharedTaskMutex);
+			if (!sharedTasks[priority].empty()) {
+				task = sharedTasks[priority].front();
+				sharedTasks[priority].pop_front();
+				sharedTaskCount--;
+				return task;
+			}
+		}
+
+		auto* list = queues.load(std::memory_order_acquire);
+		if (list && !list->empty()) {
+			//start at a different queue per thread to spread the thieves
+			static thread_local uint32_t stealIndex = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+			int count = (int)list->size();
+			int start = (int)(stealIndex++ % count);
+			for (int i = 0; i < count; i++) {
+				TaskQueue* threadQueues = (*list)[(start + i) % count];
+				if (threadQueues != ownQueues && threadQueues[priority].steal(task)) {
+					return task;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	bool TaskManager::hasPendingTasks(int lowestPriority) {
+		if (sharedTaskCount.load() > 0) {
+			if (lowestPriority == priorityCount - 1) {
+				return true;
+			}
+			LOCK(sharedTaskMutex);
+			for (int priority = 0; priority <= lowestPriority; priority++) {
+				if (!sharedTasks[priority].empty()) {
+					return true;
+				}
+			}
+		}
+		if (auto* list = queues.load(std::memory_order_acquire)) {
+			for (auto* threadQueues : *list) {
+				for (int priority = 0; priority <= lowestPriority; priority++) {
+					if (!threadQueues[priority].empty()) {
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	void TaskManager::executeTask(Task* task) {
+		TaskState scheduled = TaskState::SCHEDULED;
+		if (task->state.compare_exchange_strong(scheduled, TaskState::RUNNING, std::memory_order_acquire)) {
+			runTask(task);
+		}
+		else {
+			//terminated while pending
+			releaseTask(task);
+		}
+	}
+
+	void TaskManager::runTask(Task* task) {
+		uint64_t previousTaskId = 0;
+		uint64_t previousHelpTime = 0;
 		if (currentThread) {
-			currentThread->taskId = task.taskId;
+			previousTaskId = currentThread->taskId;
+			previousHelpTime = currentThread->helpTime;
+			currentThread->taskId = task->taskId.load(std::memory_order_relaxed);
+			currentThread->helpTime = 0;
 		}
-		if (task.callback) {
-			lock.unlock();
-			task.callback();
-			lock.lock();
+		bool profile = isProfiling();
+		uint64_t startTime = profile ? Clock::nowNano() : 0;
+		if (task->callback) {
+			task->callback();
 		}
+		uint64_t endTime = profile || task->deadline > 0 ? Clock::nowNano() : 0;
+		uint64_t helpTime = 0;
 		if (currentThread) {
-			currentThread->taskId = 0;
+			//a task run by a join pauses the time of the joining task
+			helpTime = currentThread->helpTime;
+			currentThread->taskId = previousTaskId;
+			currentThread->helpTime = previousHelpTime + (profile ? endTime - startTime : 0);
+		}
+		if (task->deadline > 0) {
+			countDeadline(task, endTime);
+		}
+		if (profile) {
+			profileTask(task, startTime, endTime, helpTime);
 		}
 
-		if (task.type == TaskType::RECURRING) {
-			task.state = TaskState::CREATED;
-			task.startTime = task.startTime + task.reccuringInterval;
-			scheduleTask(task.taskId);
+		if (task->type.load() == TaskType::RECURRING) {
+			//the next start stays on the grid of the first start, intervals missed by a long callback are skipped
+			uint64_t interval = task->reccuringInterval;
+			uint64_t now = Clock::nowNano();
+			task->startTime += interval;
+			if (task->startTime <= now) {
+				task->startTime += interval > 0 ? ((now - task->startTime) / interval + 1) * interval : now - task->startTime;
+			}
+			if (!addWaitingTask(task, TaskState::RUNNING)) {
+				finishTask(task, TaskState::TERMINATED);
+			}
 		}
 		else {
-			task.state = TaskState::FINIESHED;
-			taskFinished.notify_all();
+			finishTask(task, task->state.load() == TaskState::TERMINATED ? TaskState::TERMINATED : TaskState::FINIESHED);
 		}
 	}
 
+	void TaskManager::finishTask(Task* task, TaskState state) {
+		task->state.store(state, std::memory_order_release);
+		releaseTask(task);
+		notifyTaskFinished();
+	}
+
 	void TaskManager::runWorker() {
 		if (currentThread) {
-			currentThread->isWorker = true;
+			int spin = 0;
 			while (currentThread->running) {
-				bool hasRunTask = false;
-
-				std::unique_lock<std::mutex> lock(taskDataMutex);
-				for (auto& i : tasks) {
-					Task& task = i.second;
-					if (task.state == TaskState::SCHEDULED) {
-						hasRunTask = true;
-						currentThread->state = ThreadState::RUNNING_TASK;
-						task.state = TaskState::RUNNING;
-						lock.unlock();
-						runTask(task.taskId);
-						lock.lock();
-						if (currentThread->state != ThreadState::TERMINATED) {
-							currentThread->state = ThreadState::WAIT_FOR_TASK;
-						}
-						break;
+				if (Task* task = findTask()) {
+					spin = 0;
+					currentThread->state = ThreadState::RUNNING_TASK;
+					executeTask(task);
+					if (currentThread->state != ThreadState::TERMINATED) {
+						currentThread->state = ThreadState::WAIT_FOR_TASK;
 					}
+					continue;
+				}
+
+				if (spin++ < idleSpinCount) {
+					std::this_thread::yield();
+					continue;
 				}
+				spin = 0;
 
-				if (!hasRunTask) {
-					wakeupWorker.wait(lock);
+				idleWorkers.fetch_add(1);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				{
+					LOCK(sleepMutex);
+					if (currentThread->running && !hasPendingTasks()) {
+						wakeupWorker.wait(lock_sleepMutex);
+					}
 				}
+				idleWorkers.fetch_sub(1);
 			}
 		}
 	}
 
 	void TaskManager::runTimer() {
 		if (currentThread) {
+			std::vector<Task*> dueTasks;
+			//tasks that do not go to the shared queue, single threading tasks and tasks of named queues
+			std::vector<Task*> dueSingleThreadingTasks;
+			std::unique_lock<std::mutex> lock(timerMutex);
 			while (currentThread->running) {
-				uint64_t now = Clock::nowMilli();
-				uint64_t minWait = -1;
-				bool hasScheduledTask = false;
-
-				std::unique_lock<std::mutex> lock(taskDataMutex);
-				for (auto& i : tasks) {
-					Task& task = i.second;
-					if (task.state == TaskState::WAITING) {
-						if (task.startTime <= now) {
-							lock.unlock();
-							scheduleTask(task.taskId);
-							lock.lock();
-							hasScheduledTask = true;
+				uint64_t now = Clock::nowNano();
+				while (!timerHeap.empty() && timerHeap[0].startTime <= now) {
+					Timer timer = popTimer();
+					Task* task = getTaskSlot((int)(timer.taskId & slotMask));
+
+					//the state only becomes WAITING while holding the lock, so a reused task can not be scheduled here
+					TaskState waiting = TaskState::WAITING;
+					if (task->taskId.load() == timer.taskId && task->state.compare_exchange_strong(waiting, TaskState::SCHEDULED)) {
+						if (task->singleThreading || task->queueId >= 0) {
+							dueSingleThreadingTasks.push_back(task);
 						}
 						else {
-							uint64_t wait = task.startTime - now;
-							if (wait < minWait) {
-								minWait = wait;
-							}
+							dueTasks.push_back(task);
 						}
 					}
+					else if (cancelledTimers > 0) {
+						cancelledTimers--;
+					}
 				}
 
-				if (!hasScheduledTask) {
-					if (minWait == -1) {
-						wakeupTimer.wait(lock);
+				//due tasks are scheduled without holding the lock, they might add themselves again
+				if (!dueTasks.empty() || !dueSingleThreadingTasks.empty()) {
+					lock.unlock();
+					if (!dueTasks.empty()) {
+						{
+							LOCK(sharedTaskMutex);
+							for (Task* task : dueTasks) {
+								pushSharedTask(task);
+							}
+						}
+						wakeupWorkers(dueTasks.size() > 1);
+						dueTasks.clear();
 					}
-					else {
-						wakeupTimer.wait_for(lock, std::chrono::microseconds(minWait));
+					for (Task* task : dueSingleThreadingTasks) {
+						if (task->queueId >= 0) {
+							pushTask(task);
+						}
+						else {
+							executeTask(task);
+						}
 					}
+					dueSingleThreadingTasks.clear();
+					lock.lock();
+					continue;
+				}
+
+				if (timerHeap.empty()) {
+					wakeupTimer.wait(lock);
+				}
+				else {
+					wakeupTimer.wait_for(lock, std::chrono::nanoseconds(timerHeap[0].startTime - now));
 				}
 			}
 		}
 	}
 
-	void TaskManager::scheduleTask(int taskId) {
-		Task &task = getTask(taskId);
-		bool schedule = false;
-
-		if (task.state == TaskState::CREATED) {
-			if (task.type == TaskType::DELAYED || task.type == TaskType::RECURRING) {
-				task.state = TaskState::WAITING;
-				wakeupTimer.notify_one();
+	void TaskManager::scheduleTask(Task* task) {
+		TaskType type = task->type.load(std::memory_order_relaxed);
+		if (type == TaskType::DELAYED || type == TaskType::RECURRING) {
+			if (!addWaitingTask(task, TaskState::CREATED)) {
+				finishTask(task, TaskState::TERMINATED);
+			}
+		}
+		else {
+			//the task can be terminated as soon as its id is known, it is released here then
+			TaskState created = TaskState::CREATED;
+			if (!task->state.compare_exchange_strong(created, TaskState::SCHEDULED, std::memory_order_release)) {
+				releaseTask(task);
 			}
-			else if (task.type == TaskType::THREAD) {
-				addThread([&, taskId]() {
+			else if (type == TaskType::THREAD) {
+				addThread([this, task]() {
 					currentThread->state = ThreadState::RUNNING_TASK;
-					runTask(taskId);
-				}, task.name);
+					executeTask(task);
+				}, task->name);
+			}
+			else if (task->singleThreading) {
+				executeTask(task);
 			}
 			else {
-				schedule = true;
+				pushTask(task);
+			}
+		}
+	}
+
+	bool TaskManager::addWaitingTask(Task* task, TaskState state) {
+		//the task can be cancelled and reused as soon as it is waiting
+		Timer timer = { task->startTime, task->taskId.load() };
+		LOCK(timerMutex);
+		if (!task->state.compare_exchange_strong(state, TaskState::WAITING)) {
+			return false;
+		}
+
+		//drop cancelled timers when they make up most of the heap
+		if (cancelledTimers * 2 > (int)timerHeap.size() && timerHeap.size() > 64) {
+			std::vector<Timer> timers;
+			timers.swap(timerHeap);
+			for (auto& timer : timers) {
+				if (isTimerValid(timer)) {
+					pushTimer(timer);
+				}
 			}
+			cancelledTimers = 0;
+		}
+
+		pushTimer(timer);
+		//the timer thread only needs to wake up when the next start time changed
+		if (timerHeap[0].taskId == timer.taskId) {
+			wakeupTimer.notify_one();
 		}
-		else if (task.state == TaskState::WAITING) {
-			schedule = true;
+		return true;
+	}
+
+	void TaskManager::cancelWaitingTask(Task* task) {
+		//the timer is removed from the heap later
+		cancelledTimers++;
+		releaseTask(task);
+	}
+
+	bool TaskManager::isTimerValid(const Timer& timer) {
+		Task* task = getTaskSlot((int)(timer.taskId & slotMask));
+		return task->taskId.load() == timer.taskId && task->state.load() == TaskState::WAITING;
+	}
+
+	void TaskManager::pushTimer(const Timer& timer) {
+		int index = (int)timerHeap.size();
+		timerHeap.push_back(timer);
+		while (index > 0) {
+			int parent = (index - 1) / 4;
+			if (timerHeap[parent].startTime <= timer.startTime) {
+				break;
+			}
+			timerHeap[index] = timerHeap[parent];
+			index = parent;
 		}
+		timerHeap[index] = timer;
+	}
 
+	TaskManager::Timer TaskManager::popTimer() {
+		Timer result = timerHeap[0];
+		Timer timer = timerHeap.back();
+		timerHeap.pop_back();
+		int count = (int)timerHeap.size();
+		if (count > 0) {
+			int index = 0;
+			while (true) {
+				int first = index * 4 + 1;
+				if (first >= count) {
+					break;
+				}
+				int child = first;
+				int last = std::min(first + 4, count);
+				for (int i = first + 1; i < last; i++) {
+					if (timerHeap[i].startTime < timerHeap[child].startTime) {
+						child = i;
+					}
+				}
+				if (timer.startTime <= timerHeap[child].startTime) {
+					break;
+				}
+				timerHeap[index] = timerHeap[child];
+				index = child;
+			}
+			timerHeap[index] = timer;
+		}
+		return result;
+	}
 
-		if (schedule) {
-			if (task.singleThreading) {
-				runTask(taskId);
+	void TaskManager::wakeupWorkers(bool all) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (idleWorkers.load(std::memory_order_relaxed) > 0) {
+			{
+				LOCK(sleepMutex);
+			}
+			if (all) {
+				wakeupWorker.notify_all();
 			}
 			else {
-				task.state = TaskState::SCHEDULED;
 				wakeupWorker.notify_one();
 			}
 		}
+		else if (joiningThreads.load(std::memory_order_relaxed) > 0) {
+			//joining threads help executing tasks
+			{
+				LOCK(sleepMutex);
+			}
+			taskFinished.notify_all();
+		}
+	}
+
+	void TaskManager::notifyTaskFinished() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (awaitingCoroutineCount.load(std::memory_order_relaxed) > 0) {
+			resumeAwaitingCoroutines();
+		}
+		if (joiningThreads.load(std::memory_order_relaxed) > 0) {
+			{
+				LOCK(sleepMutex);
+			}
+			taskFinished.notify_all();
+		}
 	}
 
-	void TaskManager::removeFinishedTasks() {
-		LOCK(taskDataMutex);
-		for (auto it = tasks.begin(); it != tasks.end();) {
-			if (it->second.state == TaskState::FINIESHED || it->second.state == TaskState::TERMINATED) {
-				tasks.erase(it++);
+	TaskManager::ScheduleAwaiter TaskManager::schedule(TaskPriority priority) {
+		return ScheduleAwaiter{ this, 0, priority };
+	}
+
+	TaskManager::ScheduleAwaiter TaskManager::delay(uint64_t delayMillis) {
+		return ScheduleAwaiter{ this, delayMillis, TaskPriority::NORMAL };
+	}
+
+	TaskManager::JoinAwaiter TaskManager::joinAsync(uint64_t taskId) {
+		return JoinAwaiter{ this, taskId };
+	}
+
+	bool TaskManager::isTaskDone(uint64_t taskId) {
+		Task* task = getTask(taskId);
+		if (!task) {
+			return true;
+		}
+		TaskState state = task->state.load();
+		return state == TaskState::FINIESHED || state == TaskState::TERMINATED;
+	}
+
+	void TaskManager::resumeCoroutine(std::coroutine_handle<> handle, uint64_t delayMillis, TaskPriority priority) {
+		addTask([handle]() {
+			handle.resume();
+		}, delayMillis > 0 ? TaskType::DELAYED : TaskType::NORMAL, "", delayMillis, nullptr, false, priority);
+	}
+
+	bool TaskManager::addAwaitingCoroutine(uint64_t taskId, std::coroutine_handle<> handle) {
+		LOCK(awaitingCoroutineMutex);
+		awaitingCoroutines.push_back({ taskId, handle });
+		awaitingCoroutineCount.fetch_add(1);
+
+		//pairs with the fence in notifyTaskFinished, either the finishing thread sees the coroutine or it is done here
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (isTaskDone(taskId)) {
+			awaitingCoroutines.pop_back();
+			awaitingCoroutineCount.fetch_sub(1);
+			return false;
+		}
+		return true;
+	}
+
+	void TaskManager::resumeAwaitingCoroutines() {
+		std::vector<std::coroutine_handle<>> handles;
+		{
+			LOCK(awaitingCoroutineMutex);
+			for (int i = 0; i < awaitingCoroutines.size();) {
+				if (isTaskDone(awaitingCoroutines[i].taskId)) {
+					handles.push_back(awaitingCoroutines[i].handle);
+					awaitingCoroutines[i] = awaitingCoroutines.back();
+					awaitingCoroutines.pop_back();
+					awaitingCoroutineCount.fetch_sub(1);
+				}
+				else {
+					i++;
+				}
 			}
-			else {
-				it++;
+		}
+		for (auto handle : handles) {
+			resumeCoroutine(handle, 0, TaskPriority::NORMAL);
+		}
+	}
+
+	int TaskManager::getGrainSize(int count, int grainSize) {
+		if (grainSize > 0) {
+			return grainSize;
+		}
+		int threadCount = startedWorkers.load(std::memory_order_relaxed) + 1;
+		return std::max(1, count / (threadCount * chunksPerThread));
+	}
+
+	void TaskManager::parallelChunks(int chunkCount, void* context, void (*callback)(void* context, int chunk)) {
+		if (chunkCount <= 0) {
+			return;
+		}
+
+		class Chunks {
+		public:
+			std::atomic<int> nextChunk = 0;
+			int chunkCount = 0;
+			void* context = nullptr;
+			void (*callback)(void* context, int chunk) = nullptr;
+
+			void run() {
+				for (int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+					callback(context, chunk);
+				}
 			}
+		};
+		Chunks chunks;
+		chunks.chunkCount = chunkCount;
+		chunks.context = context;
+		chunks.callback = callback;
+
+		//one task per worker takes chunks until none are left
+		//the task only captures a reference, so it is stored inside the task record without allocation
+		//the calling thread waits for the chunks, so they are picked before other work
+		uint64_t taskIds[maxParallelTasks];
+		int taskCount = std::min(std::min(startedWorkers.load(std::memory_order_relaxed), chunkCount - 1), maxParallelTasks);
+		for (int i = 0; i < taskCount; i++) {
+			taskIds[i] = addTask([&chunks]() {
+				chunks.run();
+			}, TaskPriority::HIGH);
+		}
+		chunks.run();
+		for (int i = 0; i < taskCount; i++) {
+			joinTask(taskIds[i]);
 		}
 	}
 
@@ -353,6 +1015,22 @@ namespace tridot2d {
 		}
 	}
 
+	void TaskManager::setThreadAffinity(int threadId, int cpu) {
+#ifdef __linux__
+		LOCK(threadDataMutex);
+		for (auto& thread : threads) {
+			if (thread->threadId == threadId && thread->thread) {
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(cpu, &cpus);
+				if (pthread_setaffinity_np(thread->thread->native_handle(), sizeof(cpus), &cpus) != 0) {
+					Log::warning("could not pin thread %s to cpu %d", thread->name.c_str(), cpu);
+				}
+			}
+		}
+#endif
+	}
+
 	TaskManager::Thread& TaskManager::getThread(int threadId) {
 		for (auto& thread : threads) {
 			if (thread->threadId == threadId) {
@@ -362,11 +1040,282 @@ namespace tridot2d {
 		return defaultThread;
 	}
 
-	std::vector<int> TaskManager::getTaskIds() {
-		LOCK(taskDataMutex)
-		std::vector<int> ids;
-		for (auto& i : tasks) {
-			ids.push_back(i.first);
+	uint64_t TaskManager::getDueTime(Task* task) {
+		TaskType type = task->type.load(std::memory_order_relaxed);
+		return type == TaskType::DELAYED || type == TaskType::RECURRING ? task->startTime : task->createTime;
+	}
+
+	void TaskManager::countDeadline(Task* task, uint64_t now) {
+		//the deadline starts when the task is due
+		uint64_t due = getDueTime(task);
+
+		DeadlineCounters& counters = deadlineCounters[(int)task->priority];
+		counters.tasks.fetch_add(1, std::memory_order_relaxed);
+		if (now > due + task->deadline) {
+			uint64_t lateness = now - (due + task->deadline);
+			counters.missedDeadlines.fetch_add(1, std::memory_order_relaxed);
+			counters.totalLateness.fetch_add(lateness, std::memory_order_relaxed);
+			uint64_t maxLateness = counters.maxLateness.load(std::memory_order_relaxed);
+			while (lateness > maxLateness && !counters.maxLateness.compare_exchange_weak(maxLateness, lateness, std::memory_order_relaxed)) {}
+		}
+	}
+
+	bool TaskManager::isProfiling() {
+		return profiling.load(std::memory_order_relaxed) || traceState.load(std::memory_order_relaxed) == TRACE_RECORDING;
+	}
+
+	void TaskManager::profileTask(Task* task, uint64_t startTime, uint64_t endTime, uint64_t helpTime) {
+		uint64_t due = getDueTime(task);
+		uint64_t queueLatency = due > 0 && startTime > due ? startTime - due : 0;
+		uint64_t executionTime = endTime - startTime > helpTime ? endTime - startTime - helpTime : 0;
+
+		Thread* thread = currentThread && currentThread->taskManager == this ? currentThread : nullptr;
+		if (thread) {
+			//resetProfiles may write concurrently, so the counters are only changed by atomic operations
+			Thread::Profile& profile = thread->profile;
+			profile.tasks.fetch_add(1, std::memory_order_relaxed);
+			profile.busyTime.fetch_add(executionTime, std::memory_order_relaxed);
+			profile.totalQueueLatency.fetch_add(queueLatency, std::memory_order_relaxed);
+			uint64_t maxQueueLatency = profile.maxQueueLatency.load(std::memory_order_relaxed);
+			while (queueLatency > maxQueueLatency && !profile.maxQueueLatency.compare_exchange_weak(maxQueueLatency, queueLatency, std::memory_order_relaxed)) {}
+			uint64_t maxExecutionTime = profile.maxExecutionTime.load(std::memory_order_relaxed);
+			while (executionTime > maxExecutionTime && !profile.maxExecutionTime.compare_exchange_weak(maxExecutionTime, executionTime, std::memory_order_relaxed)) {}
+		}
+
+		if (traceState.load(std::memory_order_relaxed) == TRACE_RECORDING) {
+			TraceEvent event;
+			//the name is only written before the task is scheduled
+			event.name = task->name;
+			event.taskId = task->taskId.load(std::memory_order_relaxed);
+			event.dueTime = due;
+			event.startTime = startTime;
+			event.endTime = endTime;
+			if (thread) {
+				std::unique_lock<std::mutex> threadLock(thread->traceMutex);
+				thread->traceEvents.push_back(std::move(event));
+			}
+			else {
+				LOCK(traceMutex);
+				externalTraceEvents.push_back(std::move(event));
+			}
+		}
+	}
+
+	void TaskManager::setProfiling(bool enabled) {
+		if (enabled && !profiling) {
+			resetProfiles();
+		}
+		profiling = enabled;
+	}
+
+	std::vector<TaskManager::ThreadProfile> TaskManager::getThreadProfiles() {
+		LOCK(threadDataMutex);
+		uint64_t time = Clock::nowNano() - profilingStartTime;
+		std::vector<ThreadProfile> profiles;
+		auto add = [&](Thread& thread) {
+			ThreadProfile profile;
+			profile.threadId = thread.threadId;
+			profile.name = thread.name;
+			profile.tasks = thread.profile.tasks.load(std::memory_order_relaxed);
+			profile.busyTime = thread.profile.busyTime.load(std::memory_order_relaxed);
+			profile.totalQueueLatency = thread.profile.totalQueueLatency.load(std::memory_order_relaxed);
+			profile.maxQueueLatency = thread.profile.maxQueueLatency.load(std::memory_order_relaxed);
+			profile.maxExecutionTime = thread.profile.maxExecutionTime.load(std::memory_order_relaxed);
+			profile.utilization = time > 0 ? (float)((double)profile.busyTime / (double)time) : 0.0f;
+			if (thread.isWorker || profile.tasks > 0) {
+				profiles.push_back(profile);
+			}
+		};
+		add(defaultThread);
+		for (auto& thread : threads) {
+			add(*thread);
+		}
+		return profiles;
+	}
+
+	void TaskManager::resetProfiles() {
+		LOCK(threadDataMutex);
+		profilingStartTime = Clock::nowNano();
+		auto reset = [](Thread& thread) {
+			thread.profile.tasks = 0;
+			thread.profile.busyTime = 0;
+			thread.profile.totalQueueLatency = 0;
+			thread.profile.maxQueueLatency = 0;
+			thread.profile.maxExecutionTime = 0;
+		};
+		reset(defaultThread);
+		for (auto& thread : threads) {
+			reset(*thread);
+		}
+	}
+
+	void TaskManager::recordTrace(int frameCount, const std::string& file) {
+		LOCK(traceMutex);
+		traceFile = file;
+		traceFramesLeft = frameCount;
+		traceState = frameCount > 0 ? TRACE_REQUESTED : TRACE_OFF;
+	}
+
+	void TaskManager::markFrame() {
+		if (traceState.load(std::memory_order_relaxed) == TRACE_OFF) {
+			return;
+		}
+		LOCK(traceMutex);
+		uint64_t now = Clock::nowNano();
+		if (traceState == TRACE_REQUESTED) {
+			//events left from a previous recording are dropped
+			{
+				LOCK(threadDataMutex);
+				for (auto& thread : threads) {
+					std::unique_lock<std::mutex> threadLock(thread->traceMutex);
+					thread->traceEvents.clear();
+				}
+				std::unique_lock<std::mutex> defaultThreadLock(defaultThread.traceMutex);
+				defaultThread.traceEvents.clear();
+			}
+			frameEvents.clear();
+			externalTraceEvents.clear();
+			frameStartTime = now;
+			traceState = TRACE_RECORDING;
+			return;
+		}
+		if (traceState == TRACE_RECORDING) {
+			TraceEvent frame;
+			frame.name = "frame " + std::to_string(frameEvents.size());
+			frame.startTime = frameStartTime;
+			frame.endTime = now;
+			frameEvents.push_back(frame);
+			frameStartTime = now;
+			if (--traceFramesLeft <= 0) {
+				traceState = TRACE_OFF;
+				writeTrace();
+			}
+		}
+	}
+
+	static std::string escapeJson(const std::string& text) {
+		std::string result;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+				result += c;
+			}
+			else if ((unsigned char)c < 0x20) {
+				result += ' ';
+			}
+			else {
+				result += c;
+			}
+		}
+		return result;
+	}
+
+	void TaskManager::writeTrace() {
+		//tasks that ran on threads stopped during the recording are not part of the trace
+		std::ofstream stream(traceFile);
+		if (!stream) {
+			Log::error("could not write task trace %s", traceFile.c_str());
+			return;
+		}
+		uint64_t traceStart = frameEvents.empty() ? 0 : frameEvents.front().startTime;
+		bool first = true;
+		char buffer[256];
+		auto writeEvent = [&](const TraceEvent& event, int tid, const char* category) {
+			if (event.endTime < traceStart) {
+				return;
+			}
+			std::string name = event.name.empty() ? "task " + std::to_string(event.taskId & slotMask) : escapeJson(event.name);
+			snprintf(buffer, sizeof(buffer), "%s\n{\"name\": \"", first ? "" : ",");
+			stream << buffer << name;
+			snprintf(buffer, sizeof(buffer), "\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+				category, tid, (double)(int64_t)(event.startTime - traceStart) / 1000.0, (double)(event.endTime - event.startTime) / 1000.0);
+			stream << buffer;
+			if (event.taskId != 0) {
+				double queueLatency = event.dueTime > 0 && event.startTime > event.dueTime ? (double)(event.startTime - event.dueTime) / 1000.0 : 0.0;
+				snprintf(buffer, sizeof(buffer), ", \"args\": {\"task_id\": %llu, \"queue_latency_us\": %.3f}", (unsigned long long)event.taskId, queueLatency);
+				stream << buffer;
+			}
+			stream << "}";
+			first = false;
+		};
+		auto writeThreadName = [&](int tid, const std::string& name) {
+			stream << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid << ", \"args\": {\"name\": \"" << escapeJson(name) << "\"}}";
+			first = false;
+		};
+
+		stream << "{\"traceEvents\": [";
+		writeThreadName(frameTrackId, "frames");
+		for (auto& frame : frameEvents) {
+			writeEvent(frame, frameTrackId, "frame");
+		}
+		if (!externalTraceEvents.empty()) {
+			writeThreadName(externalTrackId, "other threads");
+			for (auto& event : externalTraceEvents) {
+				writeEvent(event, externalTrackId, "task");
+			}
+		}
+
+		LOCK(threadDataMutex);
+		auto writeThread = [&](Thread& thread) {
+			std::unique_lock<std::mutex> threadLock(thread.traceMutex);
+			if (thread.traceEvents.empty()) {
+				return;
+			}
+			writeThreadName(thread.threadId, thread.name.empty() ? "main" : thread.name);
+			for (auto& event : thread.traceEvents) {
+				writeEvent(event, thread.threadId, "task");
+			}
+			thread.traceEvents.clear();
+		};
+		writeThread(defaultThread);
+		for (auto& thread : threads) {
+			writeThread(*thread);
+		}
+		stream << "\n]}\n";
+		frameEvents.clear();
+		externalTraceEvents.clear();
+	}
+
+	TaskManager::DeadlineStats TaskManager::getDeadlineStats(TaskPriority priority) {
+		DeadlineCounters& counters = deadlineCounters[(int)priority];
+		DeadlineStats stats;
+		stats.tasks = counters.tasks.load(std::memory_order_relaxed);
+		stats.missedDeadlines = counters.missedDeadlines.load(std::memory_order_relaxed);
+		stats.maxLateness = counters.maxLateness.load(std::memory_order_relaxed);
+		stats.totalLateness = counters.totalLateness.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void TaskManager::resetDeadlineStats() {
+		for (auto& counters : deadlineCounters) {
+			counters.tasks = 0;
+			counters.missedDeadlines = 0;
+			counters.maxLateness = 0;
+			counters.totalLateness = 0;
+		}
+	}
+
+	int TaskManager::getWorkerCount() {
+		LOCK(threadDataMutex)
+		int count = 0;
+		for (auto& thread : threads) {
+			if (thread->isWorker && thread->running) {
+				count++;
+			}
+		}
+		return count;
+	}
+
+	std::vector<uint64_t> TaskManager::getTaskIds() {
+		std::vector<uint64_t> ids;
+		for (int i = 0; i < taskBlockCount; i++) {
+			Task* block = taskBlocks[i].load(std::memory_order_acquire);
+			for (int j = 0; j < taskBlockSize; j++) {
+				uint64_t id = block[j].taskId.load(std::memory_order_acquire);
+				if (id != 0) {
+					ids.push_back(id);
+				}
+			}
 		}
 		return ids;
 	}
@@ -380,20 +1329,23 @@ namespace tridot2d {
 		return ids;
 	}
 
-	TaskState TaskManager::getTaskState(int taskId) {
-		return getTask(taskId).state;
+	TaskState TaskManager::getTaskState(uint64_t taskId) {
+		Task* task = getTask(taskId);
+		return task ? task->state.load() : TaskState::UNKNOWN;
 	}
 
 	ThreadState TaskManager::getThreadState(int threadId) {
 		return getThread(threadId).state;
 	}
 
-	int TaskManager::getTaskByThread(int threadId) {
+	uint64_t TaskManager::getTaskByThread(int threadId) {
 		return getThread(threadId).taskId;
 	}
 
-	std::string TaskManager::getTaskName(int taskId) {
-		return getTask(taskId).name;
+	std::string TaskManager::getTaskName(uint64_t taskId) {
+		LOCK(taskDataMutex);
+		Task* task = getTask(taskId);
+		return task ? task->name : "";
 	}
 
 	std::string TaskManager::getThreadName(int threadId) {
@@ -11,6 +11,14 @@
 #include <condition_variable>
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <coroutine>
+#include <type_traits>
+#include "WorkStealingQueue.h"
+#include "TaskFunction.h"
 
 namespace tridot2d {
 
@@ -33,6 +41,16 @@ namespace tridot2d {
 		RECURRING,
 	};
 
+	//when a thread looks for the next task it takes the highest priority first
+	//lower priorities still get a share of the picks, so they can not starve
+	enum class TaskPriority {
+		//frame critical work, e.g. physics chunks or render preparation
+		HIGH,
+		NORMAL,
+		//background work, e.g. asset decoding or path finding
+		LOW,
+	};
+
 	enum class ThreadState {
 		UNKNOWN,
 		CREATED,
@@ -42,80 +60,411 @@ namespace tridot2d {
 		TERMINATED,
 	};
 
+	template<typename T>
+	class TaskFuture;
+
 	class TaskManager {
 	public:
-		int addTask(const std::function<void()> &callback, TaskType type = TaskType::NORMAL, const std::string &name = "", uint64_t delayMillis = 0, void *owner = nullptr, bool singleThreading = false);
-		int getCurrentTaskId();
-		void joinTask(int taskId);
+		~TaskManager();
+
+		//the callback is moved into the pooled task record, callables up to TaskFunction::bufferSize bytes are stored without allocation
+		//deadlineMillis is the time after the task is due in which it should be finished, misses are counted in getDeadlineStats, 0 for no deadline
+		uint64_t addTask(TaskFunction &&callback, TaskType type = TaskType::NORMAL, const std::string &name = "", uint64_t delayMillis = 0, void *owner = nullptr, bool singleThreading = false, TaskPriority priority = TaskPriority::NORMAL, uint64_t deadlineMillis = 0);
+
+		template<typename Function>
+		uint64_t addTask(Function &&callback, TaskType type = TaskType::NORMAL, const std::string &name = "", uint64_t delayMillis = 0, void *owner = nullptr, bool singleThreading = false, TaskPriority priority = TaskPriority::NORMAL, uint64_t deadlineMillis = 0) {
+			return addTask(TaskFunction(std::forward<Function>(callback)), type, name, delayMillis, owner, singleThreading, priority, deadlineMillis);
+		}
+
+		//adds a normal task with a priority
+		template<typename Function>
+		uint64_t addTask(Function &&callback, TaskPriority priority, uint64_t deadlineMillis = 0, const std::string &name = "") {
+			return addTask(TaskFunction(std::forward<Function>(callback)), TaskType::NORMAL, name, 0, nullptr, false, priority, deadlineMillis);
+		}
+
+		//adds a task that returns a value, the result is read with the returned future
+		//defined in TaskFuture.h
+		template<typename Function>
+		TaskFuture<std::invoke_result_t<std::decay_t<Function>&>> submit(Function &&function, TaskPriority priority = TaskPriority::NORMAL);
+
+		//named queues are not run by the workers but by the thread that calls runQueue, e.g. the main thread that owns the render context
+		//returns the id of the queue, the queue is created on first use
+		int getQueue(const std::string &name);
+		//the task runs on the next runQueue call of the queue after it is due
+		//joining it from the thread that runs the queue would wait forever, that thread only runs it in runQueue
+		uint64_t addQueueTask(int queueId, TaskFunction &&callback, const std::string &name = "", uint64_t delayMillis = 0);
+
+		template<typename Function>
+		uint64_t addQueueTask(int queueId, Function &&callback, const std::string &name = "", uint64_t delayMillis = 0) {
+			return addQueueTask(queueId, TaskFunction(std::forward<Function>(callback)), name, delayMillis);
+		}
+
+		//runs the tasks that are in the queue when called, returns the number of tasks that ran
+		int runQueue(int queueId);
+		uint64_t getCurrentTaskId();
+		//waits for the task to finish, the calling thread executes pending tasks of at least the priority of the task while waiting
+		void joinTask(uint64_t taskId);
 		void joinTasksByOwner(void *owner);
-		void terminateTask(int taskId);
-		void start(int workerCount);
+
+		//waits until isDone returns true, the calling thread executes pending tasks while waiting
+		//isDone is checked again whenever a task finished, so the condition has to be completed by a task
+		//while waiting the highest priority is taken first and tasks below priority are left to the workers
+		template<typename Function>
+		void waitUntil(const Function& isDone, TaskPriority priority = TaskPriority::LOW) {
+			helpUntil([](void* context) {
+				return (bool)(*(const Function*)context)();
+			}, (void*)&isDone, priority);
+		}
+
+		void terminateTask(uint64_t taskId);
+		//pinWorkers binds each worker to one cpu, only supported on linux
+		void start(int workerCount, bool pinWorkers = false);
 		void stop(bool joinTasks = true, bool runAllTasks = false);
 
+		//calls function(i) for every i in [begin, end) and returns when all calls are done
+		//the range is split into chunks of grainSize iterations, a grainSize of 0 picks it from the worker count
+		//the calling thread executes chunks as well, no memory is allocated per iteration
+		template<typename Function>
+		void parallelFor(int begin, int end, int grainSize, const Function& function) {
+			ParallelRange<Function> range = { begin, end, getGrainSize(end - begin, grainSize), &function };
+			parallelChunks((end - begin + range.grainSize - 1) / std::max(range.grainSize, 1), &range, [](void* context, int chunk) {
+				auto* range = (ParallelRange<Function>*)context;
+				int chunkBegin = range->begin + chunk * range->grainSize;
+				int chunkEnd = std::min(chunkBegin + range->grainSize, range->end);
+				for (int i = chunkBegin; i < chunkEnd; i++) {
+					(*range->function)(i);
+				}
+			});
+		}
+
+		//function(i, value) accumulates iteration i into the value of its chunk, starting at identity
+		//the chunk values are combined in chunk order with reduce(a, b), so the result does not depend on the scheduling
+		template<typename T, typename Function, typename Reduce>
+		T parallelReduce(int begin, int end, int grainSize, const T& identity, const Function& function, const Reduce& reduce) {
+			grainSize = getGrainSize(end - begin, grainSize);
+			int chunkCount = (end - begin + grainSize - 1) / std::max(grainSize, 1);
+			std::vector<T> values(std::max(chunkCount, 0), identity);
+			parallelFor(0, chunkCount, 1, [&](int chunk) {
+				int chunkBegin = begin + chunk * grainSize;
+				int chunkEnd = std::min(chunkBegin + grainSize, end);
+				T value = identity;
+				for (int i = chunkBegin; i < chunkEnd; i++) {
+					function(i, value);
+				}
+				values[chunk] = value;
+			});
+			T result = identity;
+			for (auto& value : values) {
+				result = reduce(result, value);
+			}
+			return result;
+		}
+
+
+		//awaitable that resumes the coroutine as a task, after delayMillis if not 0
+		class ScheduleAwaiter {
+		public:
+			TaskManager* taskManager;
+			uint64_t delayMillis;
+			TaskPriority priority;
+
+			bool await_ready() { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { taskManager->resumeCoroutine(handle, delayMillis, priority); }
+			void await_resume() {}
+		};
+
+		//awaitable that resumes the coroutine as a task when the task with taskId finished
+		class JoinAwaiter {
+		public:
+			TaskManager* taskManager;
+			uint64_t taskId;
+
+			bool await_ready() { return taskManager->isTaskDone(taskId); }
+			bool await_suspend(std::coroutine_handle<> handle) { return taskManager->addAwaitingCoroutine(taskId, handle); }
+			void await_resume() {}
+		};
+
+		//co_await schedule() continues the coroutine on a worker thread
+		ScheduleAwaiter schedule(TaskPriority priority = TaskPriority::NORMAL);
+		//co_await delay(millis) continues the coroutine after the delay, no thread is blocked while waiting
+		ScheduleAwaiter delay(uint64_t delayMillis);
+		//co_await joinAsync(taskId) continues the coroutine after the task finished, no thread is blocked while waiting
+		JoinAwaiter joinAsync(uint64_t taskId);
+
+		class DeadlineStats {
+		public:
+			//finished tasks with a deadline
+			int tasks = 0;
+			int missedDeadlines = 0;
+			//unit: nanoseconds
+			uint64_t maxLateness = 0;
+			uint64_t totalLateness = 0;
+		};
+		DeadlineStats getDeadlineStats(TaskPriority priority);
+		void resetDeadlineStats();
+
+		class ThreadProfile {
+		public:
+			int threadId = 0;
+			std::string name;
+			int tasks = 0;
+			//unit: nanoseconds, the queue latency is the time from when a task was due until it started
+			uint64_t busyTime = 0;
+			uint64_t totalQueueLatency = 0;
+			uint64_t maxQueueLatency = 0;
+			uint64_t maxExecutionTime = 0;
+			//busy time divided by the time since profiling was enabled or reset
+			//tasks run while a task joins others are only counted once, so it stays at most 1
+			float utilization = 0;
+		};
+		//measures queue latency and execution time of every task, costs two clock reads per task while enabled
+		void setProfiling(bool enabled);
+		std::vector<ThreadProfile> getThreadProfiles();
+		void resetProfiles();
+		//profiling is enabled or a trace is recorded, task names are only used then
+		bool isProfiling();
+
+		//records every task of the next frameCount frames and writes them to file in the chrome trace event format
+		//the file can be opened in chrome://tracing or Perfetto, the recording starts with the next markFrame
+		void recordTrace(int frameCount, const std::string &file);
+		//marks the start of a frame, called by the application once per frame
+		void markFrame();
 
-		std::vector<int> getTaskIds();
+		int getWorkerCount();
+		std::vector<uint64_t> getTaskIds();
 		std::vector<int> getThreadIds();
-		TaskState getTaskState(int taskId);
+		TaskState getTaskState(uint64_t taskId);
 		ThreadState getThreadState(int threadId);
-		int getTaskByThread(int threadId);
-		std::string getTaskName(int taskId);
+		uint64_t getTaskByThread(int threadId);
+		std::string getTaskName(uint64_t taskId);
 		std::string getThreadName(int threadId);
 
 	private:
+		template<typename Function>
+		class ParallelRange {
+		public:
+			int begin;
+			int end;
+			int grainSize;
+			const Function* function;
+		};
+
+		class Task;
+		typedef WorkStealingQueue<Task*> TaskQueue;
+
+		class TraceEvent {
+		public:
+			std::string name;
+			uint64_t taskId = 0;
+			//unit: nanoseconds
+			uint64_t dueTime = 0;
+			uint64_t startTime = 0;
+			uint64_t endTime = 0;
+		};
+
 		class Thread {
 		public:
 			int threadId = 0;
 			std::string name = "";
 			ThreadState state = ThreadState::UNKNOWN;
-			int taskId = 0;
+			uint64_t taskId = 0;
 			std::thread* thread = nullptr;
 			std::atomic_bool running = false;
 			bool isWorker = false;
+			TaskManager* taskManager = nullptr;
+			//tasks added by this thread, one queue per priority, stolen by the other threads when idle
+			std::unique_ptr<TaskQueue[]> queues;
+
+			//written by the thread itself and reset by resetProfiles
+			class Profile {
+			public:
+				std::atomic<int> tasks = 0;
+				std::atomic<uint64_t> busyTime = 0;
+				std::atomic<uint64_t> totalQueueLatency = 0;
+				std::atomic<uint64_t> maxQueueLatency = 0;
+				std::atomic<uint64_t> maxExecutionTime = 0;
+			};
+			Profile profile;
+			//unit: nanoseconds, time of tasks run by a join inside the current task, excluded from its busy time
+			uint64_t helpTime = 0;
+			std::vector<TraceEvent> traceEvents;
+			std::mutex traceMutex;
 
 			void join();
 			void terminate();
 		};
 
+		//task records are pooled and never freed while the task manager exists
+		//the task id contains the slot index and a generation, so ids of finished tasks are not found anymore
+		//the generation has 43 bits, so a reused slot never gives an old id to a new task in practice
 		class Task {
 		public:
-			int taskId = 0;
+			std::atomic<uint64_t> taskId = 0;
+			std::atomic<TaskState> state = TaskState::UNKNOWN;
+			std::atomic<TaskType> type = TaskType::UNKONWN;
+			std::atomic<void*> owner = nullptr;
+			//guarded by taskDataMutex
 			std::string name = "";
-			TaskState state = TaskState::UNKNOWN;
-			TaskType type = TaskType::UNKONWN;
-			void* owner = nullptr;
 			bool singleThreading = false;
-			std::function<void()> callback = nullptr;
+			TaskPriority priority = TaskPriority::NORMAL;
+			//named queue of the task, -1 for the worker queues
+			int queueId = -1;
+			TaskFunction callback = nullptr;
 
-			//unit: milliseconds
+			//unit: nanoseconds
 			uint64_t createTime = 0;
 			uint64_t startTime = 0;
 			uint64_t reccuringInterval = 0;
+			uint64_t deadline = 0;
+
+			int slotIndex = 0;
+			uint64_t generation = 0;
+			std::atomic<int> nextFree = -1;
 		};
 
+		static constexpr int slotBits = 20;
+		static constexpr int slotMask = (1 << slotBits) - 1;
+		static constexpr uint64_t maxGeneration = ((uint64_t)1 << (63 - slotBits)) - 1;
+		static constexpr int taskBlockBits = 10;
+		static constexpr int taskBlockSize = 1 << taskBlockBits;
+		static constexpr int maxTaskBlocks = 1 << (slotBits - taskBlockBits);
+
 		int nextThreadId = 1;
-		int nextTaskId = 1;
 
 		std::vector<std::shared_ptr<Thread>> threads;
-		std::map<int, Task> tasks;
 		static thread_local Thread* currentThread;
 
+		std::atomic<Task*> taskBlocks[maxTaskBlocks] = {};
+		std::atomic<int> taskBlockCount = 0;
+		//lock free stack of free slot indices, the upper 32 bits are a tag against ABA
+		std::atomic<uint64_t> freeTasks = 0;
+
+		static constexpr int priorityCount = 3;
+		//every starvationInterval picks a thread looks at a lower priority first
+		static constexpr int starvationInterval = 8;
+
+		//queue arrays of all threads that can be stolen from, replaced as a whole when a thread is added
+		std::atomic<std::vector<TaskQueue*>*> queues = nullptr;
+		std::vector<std::unique_ptr<std::vector<TaskQueue*>>> queueLists;
+
+		//tasks added by threads without an own queue, one deque per priority
+		std::deque<Task*> sharedTasks[priorityCount];
+		std::atomic<int> sharedTaskCount = 0;
+		std::mutex sharedTaskMutex;
+
+		class NamedQueue {
+		public:
+			std::string name;
+			std::deque<Task*> tasks;
+			std::mutex mutex;
+		};
+		static constexpr int maxNamedQueues = 16;
+		NamedQueue namedQueues[maxNamedQueues];
+		std::atomic<int> namedQueueCount = 0;
+		std::mutex namedQueueMutex;
+
+		std::atomic<bool> profiling = false;
+		uint64_t profilingStartTime = 0;
+
+		enum TraceState {
+			TRACE_OFF,
+			TRACE_REQUESTED,
+			TRACE_RECORDING,
+		};
+		std::atomic<TraceState> traceState = TRACE_OFF;
+		static constexpr int frameTrackId = -1;
+		static constexpr int externalTrackId = -2;
+		std::string traceFile;
+		int traceFramesLeft = 0;
+		uint64_t frameStartTime = 0;
+		//frames and tasks run by threads that do not belong to the task manager, guarded by traceMutex
+		std::vector<TraceEvent> frameEvents;
+		std::vector<TraceEvent> externalTraceEvents;
+		std::mutex traceMutex;
+
+		class DeadlineCounters {
+		public:
+			std::atomic<int> tasks = 0;
+			std::atomic<int> missedDeadlines = 0;
+			std::atomic<uint64_t> maxLateness = 0;
+			std::atomic<uint64_t> totalLateness = 0;
+		};
+		DeadlineCounters deadlineCounters[priorityCount];
+
+		class Timer {
+		public:
+			uint64_t startTime;
+			uint64_t taskId;
+		};
+
+		//4-ary min heap on startTime of the delayed and recurring tasks, guarded by timerMutex
+		//cancelled timers are removed lazily, the task id tells if the task is still the same
+		std::vector<Timer> timerHeap;
+		std::atomic<int> cancelledTimers = 0;
+		std::mutex timerMutex;
+
+		//coroutines waiting for a task to finish, guarded by awaitingCoroutineMutex
+		class AwaitingCoroutine {
+		public:
+			uint64_t taskId;
+			std::coroutine_handle<> handle;
+		};
+		std::vector<AwaitingCoroutine> awaitingCoroutines;
+		std::atomic<int> awaitingCoroutineCount = 0;
+		std::mutex awaitingCoroutineMutex;
+
+		std::atomic<int> startedWorkers = 0;
+		std::atomic<int> idleWorkers = 0;
+		std::atomic<int> joiningThreads = 0;
+		std::mutex sleepMutex;
+
 		std::mutex threadDataMutex;
 		std::mutex taskDataMutex;
 		std::condition_variable wakeupWorker;
 		std::condition_variable taskFinished;
 		std::condition_variable wakeupTimer;
 
-		Task defaultTask;
 		Thread defaultThread;
 		
-		Task &getTask(int taskId);
+		Task* getTask(uint64_t taskId);
+		Task* getTaskSlot(int slotIndex);
+		Task* allocateTask();
+		Task* createTask(TaskFunction&& callback, TaskType type, const std::string& name, uint64_t delayMillis, void* owner, bool singleThreading, TaskPriority priority, uint64_t deadlineMillis);
+		void releaseTask(Task* task);
 		Thread& getThread(int threadId);
-		int addThread(const std::function<void()>& callback, const std::string& name = "");
-		void runTask(int taskId);
+		void setThreadAffinity(int threadId, int cpu);
+		int addThread(const std::function<void()>& callback, const std::string& name = "", bool isWorker = false);
+		void addQueues(TaskQueue* queues);
+		TaskQueue* getCurrentQueues();
+		void pushTask(Task* task);
+		void pushSharedTask(Task* task);
+		Task* findTask();
+		Task* findTask(TaskQueue* ownQueues, int priority);
+		uint64_t getDueTime(Task* task);
+		void countDeadline(Task* task, uint64_t now);
+		void profileTask(Task* task, uint64_t startTime, uint64_t endTime, uint64_t helpTime);
+		void writeTrace();
+		bool hasPendingTasks(int lowestPriority = priorityCount - 1);
+		void executeTask(Task* task);
+		void runTask(Task* task);
+		void finishTask(Task* task, TaskState state);
 		void runWorker();
 		void runTimer();
-		void scheduleTask(int taskId);
-		void removeFinishedTasks();
+		void scheduleTask(Task* task);
+		bool addWaitingTask(Task* task, TaskState state);
+		void cancelWaitingTask(Task* task);
+		bool isTimerValid(const Timer& timer);
+		void pushTimer(const Timer& timer);
+		Timer popTimer();
+		bool isTaskDone(uint64_t taskId);
+		void resumeCoroutine(std::coroutine_handle<> handle, uint64_t delayMillis, TaskPriority priority);
+		bool addAwaitingCoroutine(uint64_t taskId, std::coroutine_handle<> handle);
+		void resumeAwaitingCoroutines();
+		void wakeupWorkers(bool all = false);
+		void notifyTaskFinished();
+		int getGrainSize(int count, int grainSize);
+		void parallelChunks(int chunkCount, void* context, void (*callback)(void* context, int chunk));
+		void helpUntil(bool (*isDone)(void* context), void* context, TaskPriority priority);
 	};
 
 }
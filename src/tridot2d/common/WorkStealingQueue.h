@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+namespace tridot2d {
+
+	//lock free double ended queue (Chase-Lev)
+	//only the owning thread may push and pop at the bottom, any thread may steal from the top
+	//T has to be trivially copyable, the queue is used with pointers
+	template<typename T>
+	class WorkStealingQueue {
+	public:
+		WorkStealingQueue(int64_t capacity = 256) {
+			buffer.store(new Buffer(capacity), std::memory_order_relaxed);
+		}
+
+		~WorkStealingQueue() {
+			delete buffer.load(std::memory_order_relaxed);
+			for (auto* old : retiredBuffers) {
+				delete old;
+			}
+		}
+
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+		//owner only
+		void push(T value) {
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			Buffer* a = buffer.load(std::memory_order_relaxed);
+			if (b - t > a->capacity - 1) {
+				//old buffers are kept alive, a thief might still read from them
+				retiredBuffers.push_back(a);
+				a = a->grow(b, t);
+				buffer.store(a, std::memory_order_release);
+			}
+			a->put(b, value);
+			bottom.store(b + 1, std::memory_order_release);
+		}
+
+		//owner only, takes the most recently pushed value
+		bool pop(T& value) {
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			Buffer* a = buffer.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			if (t <= b) {
+				value = a->get(b);
+				if (t == b) {
+					//last element, race against thieves
+					bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+					bottom.store(b + 1, std::memory_order_relaxed);
+					return won;
+				}
+				return true;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		//any thread, takes the oldest value
+		//can fail spuriously when racing with other thieves or the owner
+		bool steal(T& value) {
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+			if (t < b) {
+				Buffer* a = buffer.load(std::memory_order_acquire);
+				T result = a->get(t);
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					return false;
+				}
+				value = result;
+				return true;
+			}
+			return false;
+		}
+
+		//approximation when used concurrently
+		int64_t size() const {
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_relaxed);
+			return b > t ? b - t : 0;
+		}
+
+		bool empty() const {
+			return size() == 0;
+		}
+
+	private:
+		class Buffer {
+		public:
+			int64_t capacity;
+			int64_t mask;
+			std::atomic<T>* data;
+
+			Buffer(int64_t capacity) {
+				//capacity is rounded up to a power of two
+				this->capacity = 1;
+				while (this->capacity < capacity) {
+					this->capacity *= 2;
+				}
+				mask = this->capacity - 1;
+				data = new std::atomic<T>[this->capacity];
+			}
+
+			~Buffer() {
+				delete[] data;
+			}
+
+			T get(int64_t index) const {
+				return data[index & mask].load(std::memory_order_relaxed);
+			}
+
+			void put(int64_t index, T value) {
+				data[index & mask].store(value, std::memory_order_relaxed);
+			}
+
+			Buffer* grow(int64_t b, int64_t t) const {
+				Buffer* result = new Buffer(capacity * 2);
+				for (int64_t i = t; i < b; i++) {
+					result->put(i, get(i));
+				}
+				return result;
+			}
+		};
+
+		alignas(64) std::atomic<int64_t> top = 0;
+		alignas(64) std::atomic<int64_t> bottom = 0;
+		alignas(64) std::atomic<Buffer*> buffer = nullptr;
+		std::vector<Buffer*> retiredBuffers;
+	};
+
+}
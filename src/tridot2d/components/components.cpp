@@ -16,13 +16,33 @@ namespace tridot2d {
 	}
 
 	void Sprite::update() {
-		Singleton::get<Renderer2D>()->submitQuad(entity->position + offset, entity->scale * scale, entity->rotation + rotation, depth, texture.get(), color, coords1, coords2);
+		glm::vec2 fullScale = entity->scale * scale;
+		float angle = entity->rotation + rotation;
+		if (!cached || fullScale != cachedScale || angle != cachedRotation) {
+			glm::vec2 halfScale = fullScale * 0.5f;
+			float sin = glm::sin(angle);
+			float cos = glm::cos(angle);
+			axisX = glm::vec2(cos, sin) * halfScale.x;
+			axisY = glm::vec2(-sin, cos) * halfScale.y;
+			cached = true;
+			cachedScale = fullScale;
+			cachedRotation = angle;
+		}
+		Singleton::get<Renderer2D>()->submitQuadAxes(entity->position + offset, axisX, axisY, depth, texture.get(), color, coords1, coords2);
 	};
 
 	void Velocity::update() {
 		float dt = Singleton::get<Time>()->deltaTime;
-		entity->position += velocity * dt;
-		entity->rotation += angular * dt;
+		entity->setPosition(entity->position + velocity * dt);
+		entity->setRotation(entity->rotation + angular * dt);
+	}
+
+	void Velocity::updateAll(std::span<Velocity*> components) {
+		float dt = Singleton::get<Time>()->deltaTime;
+		for (auto* comp : components) {
+			comp->entity->setPosition(comp->entity->position + comp->velocity * dt);
+			comp->entity->setRotation(comp->entity->rotation + comp->angular * dt);
+		}
 	}
 
 	LifeTime::LifeTime(float time) {
@@ -37,6 +57,16 @@ namespace tridot2d {
 		}
 	}
 
+	void LifeTime::updateAll(std::span<LifeTime*> components) {
+		float dt = Singleton::get<Time>()->deltaTime;
+		for (auto* comp : components) {
+			comp->timeLeft -= dt;
+			if (comp->timeLeft <= 0) {
+				comp->entity->removeEntity();
+			}
+		}
+	}
+
 	SpriteSheet::SpriteSheet(const std::string& texture) {
 		this->texture = Singleton::get<TextureManager>()->get(texture);
 	}
@@ -59,6 +89,14 @@ namespace tridot2d {
 		spriteSheet.texture = sprite->texture;
 	}
 
+	void SpriteAnimation::init() {
+		//the sprite may have been copied or moved together with the entity
+		Sprite* ownSprite = entity->getComponent<Sprite>();
+		if (ownSprite) {
+			sprite = ownSprite;
+		}
+	}
+
 	void SpriteAnimation::set(int animationId) {
 		if (animationId != currentAnimationId) {
 			currentAnimationId = animationId;
@@ -77,6 +115,11 @@ namespace tridot2d {
 	}
 
 	void SpriteAnimation::update() {
+		//archetype storage moves components to other rows without calling init again
+		Sprite* ownSprite = entity->getComponent<Sprite>();
+		if (ownSprite) {
+			sprite = ownSprite;
+		}
 		auto i = animations.find(currentAnimationId);
 		if (i != animations.end()) {
 			Animation &anim = i->second;
@@ -23,6 +23,14 @@ namespace tridot2d {
 
 		Sprite(const std::string& texture, Color color = color::white);
 		void update() override;
+
+	private:
+		//scaled and rotated half extents, recomputed when the scale or rotation of the entity or the sprite changed
+		bool cached = false;
+		glm::vec2 cachedScale = { 1, 1 };
+		float cachedRotation = 0;
+		glm::vec2 axisX = { 0, 0 };
+		glm::vec2 axisY = { 0, 0 };
 	};
 
 	class Velocity : public Component {
@@ -34,6 +42,7 @@ namespace tridot2d {
 			: velocity(velocity), angular(angular) {}
 
 		void update() override;
+		static void updateAll(std::span<Velocity*> components);
 	};
 
 	class LifeTime : public Component {
@@ -43,6 +52,7 @@ namespace tridot2d {
 		LifeTime(float time = 1);
 
 		void update() override;
+		static void updateAll(std::span<LifeTime*> components);
 	};
 
 	class SpriteSheet {
@@ -86,6 +96,7 @@ namespace tridot2d {
 		Animation& add(int animationId, std::vector<int> spriteIndices = {}, float time = 1, bool loop = false);
 		void set(int animationId);
 
+		void init() override;
 		void update() override;
 	};
 
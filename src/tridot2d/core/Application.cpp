@@ -9,6 +9,7 @@
 #include "systems/DebugUI.h"
 #include "render/RenderContext.h"
 #include "common/Singleton.h"
+#include "common/TaskManager.h"
 #include "util/strutil.h"
 
 
@@ -24,7 +25,9 @@ namespace tridot2d {
 	static void MainLoopWrapper() {
 	    if (g_currentApp && g_currentApp->window->isOpen()) {
 	        g_currentApp->window->setVSync(2);
+	        g_currentApp->taskManager->markFrame();
 	        g_currentApp->window->update();
+	        g_currentApp->taskManager->runQueue(g_currentApp->mainQueue);
 	        g_currentApp->debugUI->beginFrame();
 	        g_currentApp->window->beginFrame();
 	        g_currentApp->update();
@@ -42,7 +45,9 @@ namespace tridot2d {
     	emscripten_set_main_loop(MainLoopWrapper, 0, 1);
 #else
 		while (window->isOpen()) {
+			taskManager->markFrame();
 			window->update();
+			taskManager->runQueue(mainQueue);
 			debugUI->beginFrame();
 			window->beginFrame();
 			update();
@@ -71,6 +76,9 @@ namespace tridot2d {
 		window->init(width, height, title, swapInterval, maximized, fullscreen);
 		RenderContext::set(window->getContext());
 
+		taskManager = Singleton::get<TaskManager>();
+		mainQueue = taskManager->getQueue("main");
+
 		debugUI = Singleton::get<DebugUI>();
 		debugUI->init();
 
@@ -15,6 +15,9 @@ namespace tridot2d {
 		std::vector<ApplicationLayer*> layers;
 		class Window* window;
 		class DebugUI* debugUI;
+		class TaskManager* taskManager;
+		//tasks added to this queue run on the main thread at the start of every frame, e.g. uploads to the render context
+		int mainQueue = -1;
 
 		virtual void run();
 		virtual void update();
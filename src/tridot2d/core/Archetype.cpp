@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "Archetype.h"
+#include "EntitySystem.h"
+
+namespace tridot2d {
+
+	Archetype::Archetype(const std::vector<int>& typeIds)
+		: typeIds(typeIds) {
+		for (int typeId : typeIds) {
+			Column column;
+			column.type = ComponentType::get(typeId);
+			columns.push_back(column);
+		}
+	}
+
+	Archetype::~Archetype() {
+		while (!entities.empty()) {
+			removeRow(entities.size() - 1);
+		}
+		for (auto& column : columns) {
+			for (auto* chunk : column.chunks) {
+				::operator delete(chunk, std::align_val_t(column.type->alignment));
+			}
+			column.chunks.clear();
+		}
+	}
+
+	int Archetype::getColumn(int typeId) {
+		auto i = std::lower_bound(typeIds.begin(), typeIds.end(), typeId);
+		if (i != typeIds.end() && *i == typeId) {
+			return i - typeIds.begin();
+		}
+		return -1;
+	}
+
+	Component* Archetype::get(int column, int row) {
+		return (Component*)getAddress(column, row);
+	}
+
+	int Archetype::getRowCount() {
+		return entities.size();
+	}
+
+	int Archetype::addRow(Entity* entity) {
+		int row = entities.size();
+		entities.push_back(entity);
+		for (auto& column : columns) {
+			if (row / chunkSize >= column.chunks.size()) {
+				void* chunk = ::operator new(column.type->size * chunkSize, std::align_val_t(column.type->alignment));
+				column.chunks.push_back((uint8_t*)chunk);
+			}
+		}
+		return row;
+	}
+
+	void Archetype::removeRow(int row) {
+		if (row < 0 || row >= entities.size()) {
+			return;
+		}
+
+		for (int i = 0; i < columns.size(); i++) {
+			columns[i].type->destroy(getAddress(i, row));
+		}
+
+		int last = entities.size() - 1;
+		if (row != last) {
+			Entity* moved = entities[last];
+			for (int i = 0; i < columns.size(); i++) {
+				void* from = getAddress(i, last);
+				void* to = getAddress(i, row);
+				columns[i].type->moveConstruct(to, from);
+				columns[i].type->destroy(from);
+				moved->relocateComponent((Component*)from, (Component*)to);
+			}
+			entities[row] = moved;
+			moved->archetypeRow = row;
+		}
+		entities.pop_back();
+	}
+
+	void* Archetype::getAddress(int column, int row) {
+		Column& col = columns[column];
+		return col.chunks[row / chunkSize] + (row % chunkSize) * col.type->size;
+	}
+
+}
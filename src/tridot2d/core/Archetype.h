@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "ComponentType.h"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace tridot2d {
+
+	//stores the components of all entities with the same set of component types
+	//each component type has its own column, a column is a list of chunks with chunkSize components each
+	//rows are kept dense, removing a row moves the last row into the gap
+	class Archetype {
+	public:
+		static constexpr int chunkSize = 256;
+
+		std::vector<int> typeIds;
+		std::vector<class Entity*> entities;
+
+		Archetype(const std::vector<int>& typeIds);
+		~Archetype();
+
+		int getColumn(int typeId);
+		Component* get(int column, int row);
+		int getRowCount();
+
+		//reserves a row for the entity, the components of the row are not constructed
+		int addRow(Entity* entity);
+
+		//destroys the components of the row and moves the last row into the gap
+		void removeRow(int row);
+
+		template<typename T, typename Func>
+		void each(int column, Func&& callback) {
+			Column& col = columns[column];
+			int rows = entities.size();
+			for (int chunk = 0; chunk * chunkSize < rows; chunk++) {
+				T* data = (T*)col.chunks[chunk];
+				int count = std::min(chunkSize, rows - chunk * chunkSize);
+				for (int i = 0; i < count; i++) {
+					callback(data[i]);
+				}
+			}
+		}
+
+	private:
+		class Column {
+		public:
+			ComponentType* type = nullptr;
+			std::vector<uint8_t*> chunks;
+		};
+		std::vector<Column> columns;
+
+		void* getAddress(int column, int row);
+	};
+
+}
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "ComponentType.h"
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+namespace tridot2d {
+
+	static std::mutex& getTypeMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<std::shared_ptr<ComponentType>>& getTypes() {
+		static std::vector<std::shared_ptr<ComponentType>> types;
+		return types;
+	}
+
+	//lock free lookup of the first types, get is called for every component when entities are copied
+	static constexpr int typeTableSize = 1024;
+	static std::atomic<ComponentType*> typeTable[typeTableSize];
+
+	ComponentType* ComponentType::get(int id) {
+		if (id >= 0 && id < typeTableSize) {
+			if (ComponentType* type = typeTable[id].load(std::memory_order_acquire)) {
+				return type;
+			}
+		}
+		std::unique_lock<std::mutex> lock(getTypeMutex());
+		auto& types = getTypes();
+		if (id >= 0 && id < types.size()) {
+			return types[id].get();
+		}
+		return nullptr;
+	}
+
+	int ComponentType::getCount() {
+		std::unique_lock<std::mutex> lock(getTypeMutex());
+		return getTypes().size();
+	}
+
+	int ComponentType::add(size_t hashCode, const ComponentType& type) {
+		//the registry lives in this translation unit so that ids are shared across module boundaries
+		static std::unordered_map<size_t, int> ids;
+		std::unique_lock<std::mutex> lock(getTypeMutex());
+		auto entry = ids.find(hashCode);
+		if (entry != ids.end()) {
+			return entry->second;
+		}
+
+		auto& types = getTypes();
+		int id = types.size();
+		auto info = std::make_shared<ComponentType>(type);
+		info->id = id;
+		types.push_back(info);
+		ids[hashCode] = id;
+		if (id < typeTableSize) {
+			typeTable[id].store(info.get(), std::memory_order_release);
+		}
+		return id;
+	}
+
+}
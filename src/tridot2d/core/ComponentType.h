@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "common/Pool.h"
+#include <string>
+#include <memory>
+#include <typeinfo>
+#include <type_traits>
+#include <new>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace tridot2d {
+
+	class Component;
+
+	//type erased info about a component type, ids are dense and start at 0
+	class ComponentType {
+	public:
+		int id = -1;
+		std::string name;
+		size_t size = 0;
+		size_t alignment = 0;
+
+		void (*copyConstruct)(void* dst, const void* src) = nullptr;
+		void (*moveConstruct)(void* dst, void* src) = nullptr;
+		void (*destroy)(void* ptr) = nullptr;
+		//copy of the component in pooled storage, used to deep copy entities
+		std::shared_ptr<Component> (*clone)(const Component* src) = nullptr;
+		//set if the type has a static updateAll(std::span<T*>) that updates many components at once
+		void (*updateAll)(Component** components, int count) = nullptr;
+
+		template<typename T>
+		static int getId() {
+			static int id = add(typeid(T).hash_code(), create<T>());
+			return id;
+		}
+
+		template<typename T>
+		static ComponentType* get() {
+			//types are never removed, so the pointer stays valid
+			static ComponentType* type = get(getId<T>());
+			return type;
+		}
+
+		static ComponentType* get(int id);
+		static int getCount();
+
+	private:
+		static int add(size_t hashCode, const ComponentType& type);
+
+		template<typename T>
+		static ComponentType create() {
+			ComponentType type;
+			type.name = typeid(T).name();
+			type.size = sizeof(T);
+			type.alignment = alignof(T);
+			if constexpr (std::is_copy_constructible_v<T>) {
+				type.copyConstruct = [](void* dst, const void* src) {
+					new (dst) T(*(const T*)src);
+				};
+			}
+			if constexpr (std::is_copy_constructible_v<T> && std::is_base_of_v<Component, T>) {
+				type.clone = [](const Component* src) -> std::shared_ptr<Component> {
+					return std::allocate_shared<T>(PoolAllocator<T>(), *(const T*)src);
+				};
+			}
+			if constexpr (requires(std::span<T*> components) { T::updateAll(components); }) {
+				type.updateAll = [](Component** components, int count) {
+					thread_local std::vector<T*> list;
+					list.resize(count);
+					for (int i = 0; i < count; i++) {
+						list[i] = static_cast<T*>(components[i]);
+					}
+					T::updateAll(std::span<T*>(list.data(), count));
+				};
+			}
+			if constexpr (std::is_move_constructible_v<T>) {
+				type.moveConstruct = [](void* dst, void* src) {
+					new (dst) T(std::move(*(T*)src));
+				};
+			}
+			if constexpr (std::is_destructible_v<T>) {
+				type.destroy = [](void* ptr) {
+					((T*)ptr)->~T();
+				};
+			}
+			return type;
+		}
+	};
+
+	//bitset over component type ids, types with an id >= maxTypes are not tracked
+	class ComponentMask {
+	public:
+		static constexpr int maxTypes = 128;
+		uint64_t bits[maxTypes / 64] = {};
+
+		void set(int typeId) {
+			if (typeId >= 0 && typeId < maxTypes) {
+				bits[typeId / 64] |= (uint64_t)1 << (typeId % 64);
+			}
+		}
+
+		void reset(int typeId) {
+			if (typeId >= 0 && typeId < maxTypes) {
+				bits[typeId / 64] &= ~((uint64_t)1 << (typeId % 64));
+			}
+		}
+
+		bool test(int typeId) const {
+			if (typeId >= 0 && typeId < maxTypes) {
+				return bits[typeId / 64] & ((uint64_t)1 << (typeId % 64));
+			}
+			return false;
+		}
+
+		//number of set bits below typeId
+		int rank(int typeId) const {
+			int count = 0;
+			for (int i = 0; i < typeId / 64; i++) {
+				count += std::popcount(bits[i]);
+			}
+			count += std::popcount(bits[typeId / 64] & (((uint64_t)1 << (typeId % 64)) - 1));
+			return count;
+		}
+
+		bool contains(const ComponentMask& mask) const {
+			for (int i = 0; i < maxTypes / 64; i++) {
+				if ((bits[i] & mask.bits[i]) != mask.bits[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool intersects(const ComponentMask& mask) const {
+			for (int i = 0; i < maxTypes / 64; i++) {
+				if (bits[i] & mask.bits[i]) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool operator==(const ComponentMask& mask) const {
+			for (int i = 0; i < maxTypes / 64; i++) {
+				if (bits[i] != mask.bits[i]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template<typename... T>
+		static ComponentMask of() {
+			ComponentMask mask;
+			(mask.set(ComponentType::getId<T>()), ...);
+			return mask;
+		}
+	};
+
+}
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#include "EntityHandle.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace tridot2d {
+
+	class EntitySlot {
+	public:
+		std::atomic<Entity*> entity = nullptr;
+		std::atomic<uint32_t> generation = 1;
+	};
+
+	//slots are allocated in pages that are never moved or freed, so lookups don't need a lock
+	static constexpr uint32_t slotPageSize = 4096;
+	static constexpr uint32_t slotPageCount = 4096;
+	static std::atomic<EntitySlot*> slotPages[slotPageCount];
+
+	static std::mutex slotMutex;
+	static std::vector<uint32_t> freeSlots;
+	static uint32_t nextSlot = 0;
+
+	static EntitySlot* getSlot(uint32_t index) {
+		if (index / slotPageSize >= slotPageCount) {
+			return nullptr;
+		}
+		EntitySlot* page = slotPages[index / slotPageSize].load(std::memory_order_acquire);
+		if (!page) {
+			return nullptr;
+		}
+		return &page[index % slotPageSize];
+	}
+
+	Entity* EntityHandle::get() const {
+		if (generation == 0) {
+			return nullptr;
+		}
+		EntitySlot* slot = getSlot(index);
+		if (!slot || slot->generation.load(std::memory_order_acquire) != generation) {
+			return nullptr;
+		}
+		Entity* entity = slot->entity.load(std::memory_order_acquire);
+		if (slot->generation.load(std::memory_order_acquire) != generation) {
+			return nullptr;
+		}
+		return entity;
+	}
+
+	bool EntityHandle::isValid() const {
+		return get() != nullptr;
+	}
+
+	EntityHandle EntityHandle::create(Entity* entity) {
+		std::unique_lock<std::mutex> lock(slotMutex);
+		uint32_t index = 0;
+		if (!freeSlots.empty()) {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else {
+			index = nextSlot++;
+			if (index / slotPageSize >= slotPageCount) {
+				nextSlot--;
+				return EntityHandle();
+			}
+			if (index % slotPageSize == 0) {
+				slotPages[index / slotPageSize].store(new EntitySlot[slotPageSize], std::memory_order_release);
+			}
+		}
+
+		EntitySlot* slot = getSlot(index);
+		slot->entity.store(entity, std::memory_order_release);
+
+		EntityHandle handle;
+		handle.index = index;
+		handle.generation = slot->generation.load(std::memory_order_relaxed);
+		return handle;
+	}
+
+	void EntityHandle::release(EntityHandle handle) {
+		EntitySlot* slot = getSlot(handle.index);
+		if (!slot || handle.generation == 0) {
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(slotMutex);
+		if (slot->generation.load(std::memory_order_relaxed) != handle.generation) {
+			return;
+		}
+		slot->entity.store(nullptr, std::memory_order_release);
+		uint32_t generation = handle.generation + 1;
+		if (generation == 0) {
+			generation = 1;
+		}
+		slot->generation.store(generation, std::memory_order_release);
+		freeSlots.push_back(handle.index);
+	}
+
+}
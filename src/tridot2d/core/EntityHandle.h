@@ -0,0 +1,29 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+
+namespace tridot2d {
+
+	//index and generation into the global entity slot table
+	//a handle becomes invalid when the entity is removed, checking it is lock free and can be done from any thread
+	class EntityHandle {
+	public:
+		uint32_t index = 0;
+		uint32_t generation = 0;
+
+		class Entity* get() const;
+		bool isValid() const;
+
+		bool operator==(const EntityHandle& handle) const {
+			return index == handle.index && generation == handle.generation;
+		}
+
+		static EntityHandle create(Entity* entity);
+		static void release(EntityHandle handle);
+	};
+
+}
@@ -5,126 +5,364 @@
 #include "EntitySystem.h"
 #include "render/Renderer2D.h"
 #include "common/Singleton.h"
+#include "common/TaskManager.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 
 namespace tridot2d {
 
-	std::map<Entity*, std::set<EntityRef*>> EntityRef::refs;
+	//non owning reference to a component that is stored in an archetype
+	static std::shared_ptr<Component> storageRef(Component* comp) {
+		return std::shared_ptr<Component>(std::shared_ptr<Component>(), comp);
+	}
+
+	Entity::~Entity() {
+		EntityHandle::release(handle);
+	}
 
 	void Entity::removeEntity() {
 		entitySystem->removeEntity(this);
 	}
 
-	Entity::Entity(const Entity& ent) {
-		components = ent.components;
-		active = ent.active;
-		entitySystem = ent.entitySystem;
-		position = ent.position;
-		scale = ent.scale;
-		rotation = ent.rotation;
-		entityIndex = ent.entityIndex;
-		for (auto& comp : components) {
-			comp->entity = this;
+	void Entity::setActive(bool active) {
+		if (this->active == active) {
+			return;
+		}
+		this->active = active;
+		if (entitySystem) {
+			entitySystem->addCommand(EntitySystem::Command::SET_ACTIVE, this);
 		}
 	}
 
-	EntityRef::EntityRef() {
-		set(nullptr);
+	uint32_t Entity::getTransformVersion() {
+		if (position != trackedPosition || scale != trackedScale || rotation != trackedRotation) {
+			trackedPosition = position;
+			trackedScale = scale;
+			trackedRotation = rotation;
+			transformVersion++;
+			if (entitySystem) {
+				entitySystem->addMovedEntity(this);
+			}
+		}
+		return transformVersion;
 	}
 
-	EntityRef::EntityRef(Entity* ent) {
-		set(ent);
+	void Entity::setPosition(const glm::vec2& position) {
+		this->position = position;
+		getTransformVersion();
+	}
+
+	void Entity::setScale(const glm::vec2& scale) {
+		this->scale = scale;
+		getTransformVersion();
+	}
+
+	void Entity::setRotation(float rotation) {
+		this->rotation = rotation;
+		getTransformVersion();
+	}
+
+	void Entity::setLocalPosition(const glm::vec2& localPosition) {
+		this->localPosition = localPosition;
+		if (entitySystem) {
+			entitySystem->addMovedEntity(this);
+		}
+	}
+
+	void Entity::setLocalScale(const glm::vec2& localScale) {
+		this->localScale = localScale;
+		if (entitySystem) {
+			entitySystem->addMovedEntity(this);
+		}
+	}
+
+	void Entity::setLocalRotation(float localRotation) {
+		this->localRotation = localRotation;
+		if (entitySystem) {
+			entitySystem->addMovedEntity(this);
+		}
+	}
+
+	bool Entity::hasMoved() {
+		return entitySystem && movedFrame != 0 && movedFrame == entitySystem->frameCount;
 	}
 
-	EntityRef::EntityRef(const EntityRef& ref) {
-		set(ref.entity);
+	Entity* Entity::getParent() {
+		return parentHandle.get();
 	}
 
-	EntityRef::EntityRef(EntityRef&& ref) {
-		set(ref.entity);
+	EntityHandle Entity::getHandle() {
+		if (!handle.isValid()) {
+			handle = EntityHandle::create(this);
+		}
+		return handle;
+	}
+
+	Component* Entity::addArchetypeComponent(int typeId, const Component* comp) {
+		return entitySystem->addArchetypeComponent(this, typeId, comp);
 	}
 
-	EntityRef::~EntityRef() {
-		set(nullptr);
+	void Entity::relocateComponent(Component* from, Component* to) {
+		for (auto& comp : components) {
+			if (comp.get() == from) {
+				comp = storageRef(to);
+				break;
+			}
+		}
+		for (auto& comp : componentLookup) {
+			if (comp == from) {
+				comp = to;
+				break;
+			}
+		}
 	}
 
-	void EntityRef::operator=(const EntityRef& ref) {
-		set(ref.entity);
+	void Entity::onComponentAdded() {
+		std::unique_lock<std::mutex> lock(entitySystem->changedMutex);
+		entitySystem->changedEntities.push_back(this);
 	}
 
+	void Entity::addComponentLookup(Component* comp) {
+		int typeId = comp->typeId;
+		if (typeId < 0 || typeId >= ComponentMask::maxTypes || componentMask.test(typeId)) {
+			return;
+		}
+		componentLookup.insert(componentLookup.begin() + componentMask.rank(typeId), comp);
+		componentMask.set(typeId);
+	}
+
+	Entity::Entity(const Entity& ent) {
+		active = ent.active;
+		entitySystem = ent.entitySystem;
+		position = ent.position;
+		scale = ent.scale;
+		rotation = ent.rotation;
+		localPosition = ent.localPosition;
+		localScale = ent.localScale;
+		localRotation = ent.localRotation;
+		//components are cloned, only components that can't be copied are shared with the original
+		components.reserve(ent.components.size());
+		for (auto& comp : ent.components) {
+			if (!comp) {
+				continue;
+			}
+			ComponentType* type = ComponentType::get(comp->typeId);
+			if (type && type->clone) {
+				components.push_back(type->clone(comp.get()));
+			}
+			else {
+				components.push_back(comp);
+			}
+			components.back()->entity = this;
+			addComponentLookup(components.back().get());
+		}
+	}
+
+	EntityRef::EntityRef(Entity* ent) {
+		set(ent);
+	}
+
+	EntityRef::EntityRef(EntityHandle handle)
+		: handle(handle) {}
+
 	void EntityRef::operator=(Entity* ent) {
 		set(ent);
 	}
 
 	bool EntityRef::operator==(Entity* ent) {
-		return ent == entity;
+		return get() == ent;
 	}
 
 	bool EntityRef::operator==(const EntityRef& ref) {
-		return ref.entity == entity;
+		return ref.handle == handle;
 	}
 
 	EntityRef::operator bool() {
-		return (bool)entity;
+		return handle.isValid();
 	}
 
 	EntityRef::operator Entity* () {
-		return entity;
+		return handle.get();
 	}
 
 	Entity* EntityRef::operator->() {
-		return entity;
+		return handle.get();
 	}
 
 	Entity& EntityRef::operator*() {
-		return *entity;
+		return *handle.get();
 	}
 
 	Entity* EntityRef::get() {
-		return entity;
+		return handle.get();
 	}
 
 	void EntityRef::set(Entity* ent) {
-		if (entity != nullptr) {
-			refs[entity].erase(this);
-			entity = nullptr;
+		if (ent) {
+			handle = ent->getHandle();
 		}
-		entity = ent;
-		if (entity != nullptr) {
-			refs[entity].insert(this);
+		else {
+			handle = EntityHandle();
 		}
 	}
 
+	EntityHandle EntityRef::getHandle() {
+		return handle;
+	}
+
 	void EntityRef::invalidate(Entity* ent) {
-		if (refs.find(ent) != refs.end()) {
-			for (auto& i : refs[ent]) {
-				if (i->entity == ent) {
-					i->entity = nullptr;
-				}
-			}
-			refs.erase(ent);
+		EntityHandle::release(ent->handle);
+		ent->handle = EntityHandle();
+	}
+
+	//entity lists are partitioned into active entities at the front and inactive entities at the back
+	//indexOf returns a reference to the index of an entity in the list
+	template<typename IndexOf>
+	static void swapEntities(std::vector<Entity*>& list, int a, int b, IndexOf&& indexOf) {
+		std::swap(list[a], list[b]);
+		indexOf(list[a]) = a;
+		indexOf(list[b]) = b;
+	}
+
+	template<typename IndexOf>
+	static void addToPartition(std::vector<Entity*>& list, int& activeCount, Entity* ent, bool active, IndexOf&& indexOf) {
+		indexOf(ent) = list.size();
+		list.push_back(ent);
+		if (active) {
+			swapEntities(list, list.size() - 1, activeCount, indexOf);
+			activeCount++;
 		}
 	}
 
+	template<typename IndexOf>
+	static void removeFromPartition(std::vector<Entity*>& list, int& activeCount, int index, IndexOf&& indexOf) {
+		if (index < activeCount) {
+			activeCount--;
+			swapEntities(list, index, activeCount, indexOf);
+			index = activeCount;
+		}
+		swapEntities(list, index, list.size() - 1, indexOf);
+		list.pop_back();
+	}
+
+	template<typename IndexOf>
+	static void updatePartition(std::vector<Entity*>& list, int& activeCount, int index, bool active, IndexOf&& indexOf) {
+		if (active && index >= activeCount) {
+			swapEntities(list, index, activeCount, indexOf);
+			activeCount++;
+		}
+		else if (!active && index < activeCount) {
+			activeCount--;
+			swapEntities(list, index, activeCount, indexOf);
+		}
+	}
+
+	//sort key of the commands recorded by the current thread while it runs a pass job
+	static thread_local uint64_t passSortKey = 0;
+
+	thread_local std::vector<EntitySystem::ThreadCommandBuffer> EntitySystem::threadCommandBuffers;
+
+	EntitySystem::EntitySystem() {
+		static std::atomic<uint64_t> nextSystemId = 1;
+		systemId = nextSystemId++;
+		ownerThread = std::this_thread::get_id();
+	}
+
 	EntitySystem::~EntitySystem() {
 		clear();
+		//the entries of the buffers in threadCommandBuffers expire and are dropped by their thread when it uses another entity system
+		//thread local storage of other threads can't be changed from here
+		commandBuffers.clear();
 	}
 
 	void EntitySystem::updatePending() {
-		for (auto* ent : pendingRemoves) {
+		if (ownerThread.load(std::memory_order_relaxed) != std::this_thread::get_id()) {
+			ownerThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		}
+		mergeCommands();
+
+		//entities can be added and removed while the pending ones are processed
+		std::vector<Entity*> removes;
+		std::vector<Entity*> adds;
+		std::vector<Entity*> changes;
+		removes.swap(pendingRemoves);
+		adds.swap(pendingAdds);
+		{
+			std::unique_lock<std::mutex> lock(changedMutex);
+			changes.swap(changedEntities);
+		}
+
+		for (auto* ent : changes) {
+			updateViews(ent);
+		}
+
+		if (!changes.empty() || !activeChanges.empty() || !removes.empty() || !adds.empty()) {
+			typeBucketsChanged = true;
+		}
+
+		//entities that are not added yet are placed by their active state when they are added
+		for (auto* ent : activeChanges) {
 			int index = ent->entityIndex;
-			if (index >= 0 && index < entities.size()) {
-				EntityRef::invalidate(ent);
-				Entity* e = entities[index];
-				entities[index] = entities.back();
-				entities[index]->entityIndex = index;
-				entities.pop_back();
-				delete e;
+			if (index >= 0 && index < entities.size() && entities[index] == ent) {
+				updateActive(ent);
+			}
+		}
+		activeChanges.clear();
+
+		//an entity can be removed more than once in a frame, entities that are not added yet can't be removed
+		int removeCount = 0;
+		for (auto* ent : removes) {
+			int index = ent->entityIndex;
+			if (!ent->removed && index >= 0 && index < entities.size() && entities[index] == ent) {
+				ent->removed = true;
+				removes[removeCount++] = ent;
+			}
+		}
+		removes.resize(removeCount);
+
+		for (auto* ent : removes) {
+			if (ent->transformNode != -1 || ent->childCount > 0) {
+				removeFromHierarchy();
+				break;
+			}
+		}
+
+		//removed entities are dropped from the moved entities of the last frame and the ones recorded for the current frame
+		for (auto* ent : removes) {
+			if (ent->movedFrame == frameCount || ent->movedFrame == frameCount + 1) {
+				auto isRemoved = [](Entity* ent) {
+					return ent->removed;
+				};
+				std::erase_if(movedEntities, isRemoved);
+				std::unique_lock<std::mutex> lock(commandBufferMutex);
+				for (auto& buffer : commandBuffers) {
+					std::erase_if(buffer->movedEntities, isRemoved);
+				}
+				break;
 			}
 		}
-		pendingRemoves.clear();
 
-		for (auto* ent : pendingAdds) {
-			ent->entityIndex = entities.size();
+		auto indexOf = [](Entity* ent) -> int& {
+			return ent->entityIndex;
+		};
+
+		for (auto* ent : removes) {
+			EntityRef::invalidate(ent);
+			removeFromViews(ent);
+			removeFromPartition(entities, activeCount, ent->entityIndex, indexOf);
+			destroyEntity(ent);
+		}
+
+		if (entities.size() + adds.size() > entities.capacity()) {
+			entities.reserve(std::max(entities.capacity() * 2, entities.size() + adds.size()));
+		}
+		for (auto* ent : adds) {
+			ent->getHandle();
+			addToPartition(entities, activeCount, ent, ent->active, indexOf);
+			if (storage == ComponentStorage::ARCHETYPE) {
+				addToArchetype(ent);
+			}
 			for (int i = 0; i < ent->components.size(); i++) {
 				auto* comp = ent->components[i].get();
 				if (comp) {
@@ -133,20 +371,25 @@ namespace tridot2d {
 			}
 			ent->entitySystem = this;
 			ent->init();
-			entities.push_back(ent);
+			updateViews(ent);
 		}
-		pendingAdds.clear();
 	}
 
 	void EntitySystem::update() {
 		updatePending();
+		updatePasses();
 
-		for (auto& entity : entities) {
-			if (entity) {
-				if (entity->active) {
+		if (updateOrder == UpdateOrder::TYPE) {
+			updateByType();
+		}
+		else {
+			//entities deactivated during the frame stay in the active range until the next updatePending
+			for (int i = 0; i < activeCount; i++) {
+				Entity* entity = entities[i];
+				if (entity->isActive()) {
 					entity->preUpdate();
 					for (auto& comp : entity->components) {
-						if (comp) {
+						if (comp && !passTypes.test(comp->typeId)) {
 							comp->update();
 						}
 					}
@@ -154,17 +397,592 @@ namespace tridot2d {
 				}
 			}
 		}
+
+		updateTransforms();
+		updateMovedEntities();
+	}
+
+	void EntitySystem::updateMovedEntities() {
+		frameCount++;
+		movedEntities.clear();
+		std::unique_lock<std::mutex> lock(commandBufferMutex);
+		for (auto& buffer : commandBuffers) {
+			for (Entity* entity : buffer->movedEntities) {
+				if (entity->isActive()) {
+					movedEntities.push_back(entity);
+				}
+				else {
+					entity->movedFrame = 0;
+				}
+			}
+			buffer->movedEntities.clear();
+		}
+	}
+
+	void EntitySystem::addMovedEntity(Entity* ent) {
+		//recorded once per frame by the thread that changed the transform
+		if (ent->movedFrame != frameCount + 1) {
+			ent->movedFrame = frameCount + 1;
+			getCommandBuffer()->movedEntities.push_back(ent);
+		}
+	}
+
+	void EntitySystem::updateByType() {
+		for (int i = 0; i < activeCount; i++) {
+			if (entities[i]->isActive()) {
+				entities[i]->preUpdate();
+			}
+		}
+
+		//the components of each type are collected again when entities, components or passes changed
+		int typeCount = ComponentType::getCount();
+		if (typeBucketsChanged) {
+			typeBuckets.resize(std::max((int)typeBuckets.size(), typeCount));
+			for (auto& bucket : typeBuckets) {
+				bucket.clear();
+			}
+			for (int i = 0; i < activeCount; i++) {
+				for (auto& comp : entities[i]->components) {
+					if (comp && comp->typeId >= 0 && !passTypes.test(comp->typeId)) {
+						typeBuckets[comp->typeId].push_back(comp.get());
+					}
+				}
+			}
+			typeBucketsChanged = false;
+		}
+
+		typeUpdateOrder.clear();
+		for (int typeId : typeOrder) {
+			if (typeId >= 0 && typeId < typeCount && std::find(typeUpdateOrder.begin(), typeUpdateOrder.end(), typeId) == typeUpdateOrder.end()) {
+				typeUpdateOrder.push_back(typeId);
+			}
+		}
+		for (int typeId = 0; typeId < typeCount; typeId++) {
+			if (std::find(typeOrder.begin(), typeOrder.end(), typeId) == typeOrder.end()) {
+				typeUpdateOrder.push_back(typeId);
+			}
+		}
+
+		for (int typeId : typeUpdateOrder) {
+			if (typeId >= typeBuckets.size() || typeBuckets[typeId].empty()) {
+				continue;
+			}
+			auto& bucket = typeBuckets[typeId];
+			ComponentType* type = ComponentType::get(typeId);
+			if (type && type->updateAll) {
+				type->updateAll(bucket.data(), bucket.size());
+			}
+			else {
+				for (auto* comp : bucket) {
+					comp->update();
+				}
+			}
+		}
+
+		for (int i = 0; i < activeCount; i++) {
+			if (entities[i]->isActive()) {
+				entities[i]->update();
+			}
+		}
 	}
 
 	void EntitySystem::removeEntity(Entity* ent) {
-		pendingRemoves.push_back(ent);
+		addCommand(Command::REMOVE_ENTITY, ent);
+	}
+
+	void EntitySystem::defer(const std::function<void()>& callback) {
+		addCommand(Command::DEFERRED, nullptr, callback);
+	}
+
+	EntitySystem::CommandBuffer* EntitySystem::getCommandBuffer() {
+		//system ids are never reused
+		for (auto& entry : threadCommandBuffers) {
+			if (entry.systemId == systemId) {
+				return entry.buffer;
+			}
+		}
+
+		std::erase_if(threadCommandBuffers, [](const ThreadCommandBuffer& entry) {
+			return entry.reference.expired();
+		});
+
+		std::unique_lock<std::mutex> lock(commandBufferMutex);
+		auto buffer = std::make_shared<CommandBuffer>();
+		buffer->threadIndex = commandBuffers.size();
+		commandBuffers.push_back(buffer);
+		threadCommandBuffers.push_back({ systemId, buffer.get(), buffer });
+		return buffer.get();
+	}
+
+	uint64_t EntitySystem::getCommandSortKey(CommandBuffer* buffer, int count) {
+		if (passSortKey != 0) {
+			return passSortKey;
+		}
+		else if (std::this_thread::get_id() == ownerThread.load(std::memory_order_relaxed)) {
+			return 0;
+		}
+		else {
+			//after all passes, by thread and then in the order the commands were recorded
+			uint64_t sortKey = ((uint64_t)1 << 63) | (buffer->threadIndex << 40) | buffer->sequence;
+			buffer->sequence += count;
+			return sortKey;
+		}
+	}
+
+	void EntitySystem::addCommand(Command::Type type, Entity* ent, const std::function<void()>& callback) {
+		Command command;
+		command.type = type;
+		command.entity = ent;
+		command.callback = callback;
+
+		CommandBuffer* buffer = getCommandBuffer();
+		std::unique_lock<std::mutex> lock(buffer->mutex);
+		command.sortKey = getCommandSortKey(buffer, 1);
+		buffer->commands.push_back(std::move(command));
+	}
+
+	void EntitySystem::addCommands(Command::Type type, Entity** ents, int count) {
+		CommandBuffer* buffer = getCommandBuffer();
+		std::unique_lock<std::mutex> lock(buffer->mutex);
+		uint64_t sortKey = getCommandSortKey(buffer, count);
+		bool sequential = sortKey >> 63;
+		if (buffer->commands.size() + count > buffer->commands.capacity()) {
+			buffer->commands.reserve(std::max(buffer->commands.capacity() * 2, buffer->commands.size() + count));
+		}
+		for (int i = 0; i < count; i++) {
+			Command command;
+			command.type = type;
+			command.entity = ents[i];
+			command.sortKey = sequential ? sortKey + i : sortKey;
+			buffer->commands.push_back(std::move(command));
+		}
+	}
+
+	void EntitySystem::mergeCommands() {
+		{
+			std::unique_lock<std::mutex> lock(commandBufferMutex);
+			for (auto& buffer : commandBuffers) {
+				std::unique_lock<std::mutex> bufferLock(buffer->mutex);
+				for (auto& command : buffer->commands) {
+					mergedCommands.push_back(std::move(command));
+				}
+				buffer->commands.clear();
+			}
+		}
+
+		//commands of a pass job are ordered by the job, not by the thread that ran it
+		//commands of the owner thread come first and commands of other threads last, ordered by thread and recording order
+		std::stable_sort(mergedCommands.begin(), mergedCommands.end(), [](const Command& a, const Command& b) {
+			return a.sortKey < b.sortKey;
+		});
+
+		for (auto& command : mergedCommands) {
+			if (command.type == Command::ADD_ENTITY) {
+				pendingAdds.push_back(command.entity);
+			}
+			else if (command.type == Command::REMOVE_ENTITY) {
+				pendingRemoves.push_back(command.entity);
+			}
+			else if (command.type == Command::SET_ACTIVE) {
+				activeChanges.push_back(command.entity);
+			}
+			else if (command.callback) {
+				command.callback();
+			}
+		}
+		mergedCommands.clear();
+	}
+
+	UpdatePass& EntitySystem::addPass(const std::string& name, const ComponentMask& required, const std::function<void(Entity*)>& callback) {
+		auto pass = std::make_shared<UpdatePass>();
+		pass->name = name;
+		pass->required = required;
+		pass->callback = callback;
+		passes.push_back(pass);
+		passesChanged = true;
+		return *pass;
+	}
+
+	void EntitySystem::removePass(const std::string& name) {
+		for (int i = 0; i < passes.size(); i++) {
+			if (passes[i]->name == name) {
+				passes.erase(passes.begin() + i);
+				i--;
+			}
+		}
+		passesChanged = true;
+	}
+
+	int EntitySystem::getPassStage(const std::string& name) {
+		updatePassStages();
+		for (int stage = 0; stage < passStages.size(); stage++) {
+			for (auto& [pass, view] : passStages[stage]) {
+				if (pass->name == name) {
+					return stage;
+				}
+			}
+		}
+		return -1;
+	}
+
+	void EntitySystem::updatePassStages() {
+		if (passesChanged) {
+			//a pass runs one stage after the last earlier pass it conflicts with
+			passStages.clear();
+			passTypes = ComponentMask();
+			std::vector<int> stageByPass(passes.size(), 0);
+			for (int i = 0; i < passes.size(); i++) {
+				for (int j = 0; j < ComponentMask::maxTypes / 64; j++) {
+					passTypes.bits[j] |= passes[i]->updates.bits[j];
+				}
+				for (int j = 0; j < i; j++) {
+					if (passes[i]->conflicts(*passes[j])) {
+						stageByPass[i] = std::max(stageByPass[i], stageByPass[j] + 1);
+					}
+				}
+				if (passStages.size() <= stageByPass[i]) {
+					passStages.resize(stageByPass[i] + 1);
+				}
+				passStages[stageByPass[i]].push_back({ passes[i].get(), getView(passes[i]->required) });
+			}
+			passesChanged = false;
+			typeBucketsChanged = true;
+		}
+	}
+
+	void EntitySystem::updatePasses() {
+		updatePassStages();
+
+		int workerCount = taskManager ? taskManager->getWorkerCount() : 0;
+		for (auto& stage : passStages) {
+			passJobs.clear();
+			for (auto& [pass, view] : stage) {
+				int count = view->activeCount;
+				int grainSize = pass->parallel && workerCount > 0 ? std::max(1, pass->grainSize) : count;
+				for (int begin = 0; begin < count; begin += grainSize) {
+					uint64_t sortKey = ((uint64_t)(&stage - &passStages[0] + 1) << 32) | passJobs.size();
+					passJobs.push_back({ pass, view, begin, std::min(begin + grainSize, count), sortKey });
+				}
+			}
+			if (passJobs.empty()) {
+				continue;
+			}
+
+			if (workerCount > 0) {
+				taskManager->parallelFor(0, (int)passJobs.size(), 1, [this](int i) {
+					runPassJob(passJobs[i]);
+				});
+			}
+			else {
+				for (auto& job : passJobs) {
+					runPassJob(job);
+				}
+			}
+		}
+	}
+
+	void EntitySystem::runPassJob(const PassJob& job) {
+		//jobs can run nested when a joining thread helps executing tasks
+		uint64_t previousSortKey = passSortKey;
+		passSortKey = job.sortKey;
+		for (int i = job.begin; i < job.end; i++) {
+			Entity* entity = job.view->entities[i];
+			if (entity->isActive()) {
+				job.pass->callback(entity);
+			}
+		}
+		passSortKey = previousSortKey;
+	}
+
+	EntityView* EntitySystem::getView(const ComponentMask& mask) {
+		for (auto& view : views) {
+			if (view->mask == mask) {
+				return view.get();
+			}
+		}
+
+		auto view = std::make_shared<EntityView>();
+		view->viewId = views.size();
+		view->mask = mask;
+		views.push_back(view);
+		for (auto* entity : entities) {
+			updateViews(entity);
+		}
+		return view.get();
+	}
+
+	void EntitySystem::updateViews(Entity* ent) {
+		if (ent->viewIndices.size() < views.size()) {
+			ent->viewIndices.resize(views.size(), -1);
+		}
+		for (auto& view : views) {
+			if (ent->viewIndices[view->viewId] == -1 && ent->componentMask.contains(view->mask)) {
+				int viewId = view->viewId;
+				addToPartition(view->entities, view->activeCount, ent, ent->active, [viewId](Entity* ent) -> int& {
+					return ent->viewIndices[viewId];
+				});
+			}
+		}
+	}
+
+	void EntitySystem::removeFromViews(Entity* ent) {
+		for (int viewId = 0; viewId < ent->viewIndices.size(); viewId++) {
+			int index = ent->viewIndices[viewId];
+			if (index != -1) {
+				auto* view = views[viewId].get();
+				removeFromPartition(view->entities, view->activeCount, index, [viewId](Entity* ent) -> int& {
+					return ent->viewIndices[viewId];
+				});
+			}
+		}
+		ent->viewIndices.clear();
+	}
+
+	void EntitySystem::updateActive(Entity* ent) {
+		bool active = ent->active;
+		updatePartition(entities, activeCount, ent->entityIndex, active, [](Entity* ent) -> int& {
+			return ent->entityIndex;
+		});
+		for (int viewId = 0; viewId < ent->viewIndices.size(); viewId++) {
+			int index = ent->viewIndices[viewId];
+			if (index != -1) {
+				auto* view = views[viewId].get();
+				updatePartition(view->entities, view->activeCount, index, active, [viewId](Entity* ent) -> int& {
+					return ent->viewIndices[viewId];
+				});
+			}
+		}
+	}
+
+	//local transform of a child relative to its parent
+	static void toLocal(glm::vec2 parentPosition, glm::vec2 parentScale, float parentRotation, Entity* ent) {
+		glm::vec2 diff = ent->position - parentPosition;
+		float sin = std::sin(-parentRotation);
+		float cos = std::cos(-parentRotation);
+		ent->localPosition = glm::vec2(diff.x * cos - diff.y * sin, diff.x * sin + diff.y * cos) / parentScale;
+		ent->localScale = ent->scale / parentScale;
+		ent->localRotation = ent->rotation - parentRotation;
+	}
+
+	//world transform of a child from its local transform
+	static void toWorld(glm::vec2 parentPosition, glm::vec2 parentScale, float parentRotation, Entity* ent) {
+		glm::vec2 local = ent->localPosition * parentScale;
+		float sin = std::sin(parentRotation);
+		float cos = std::cos(parentRotation);
+		ent->position = parentPosition + glm::vec2(local.x * cos - local.y * sin, local.x * sin + local.y * cos);
+		ent->scale = ent->localScale * parentScale;
+		ent->rotation = ent->localRotation + parentRotation;
+	}
+
+	void EntitySystem::setParent(Entity* child, Entity* parent) {
+		for (Entity* ent = parent; ent; ent = ent->getParent()) {
+			if (ent == child) {
+				//a parent can't be a child of its child
+				return;
+			}
+		}
+		Entity* oldParent = child->getParent();
+		if (oldParent == parent) {
+			return;
+		}
+		if (oldParent) {
+			oldParent->childCount--;
+		}
+
+		if (!parent) {
+			TransformNode& node = transformNodes[child->transformNode];
+			node.entity = nullptr;
+			child->parentHandle = EntityHandle();
+			child->transformNode = -1;
+			transformNodesChanged = true;
+			return;
+		}
+
+		if (child->transformNode == -1) {
+			child->transformNode = transformNodes.size();
+			transformNodes.emplace_back();
+		}
+		TransformNode& node = transformNodes[child->transformNode];
+		node.entity = child;
+		node.parent = parent;
+		node.parentVersion = parent->getTransformVersion();
+		node.parentPosition = parent->position;
+		node.parentScale = parent->scale;
+		node.parentRotation = parent->rotation;
+		toLocal(parent->position, parent->scale, parent->rotation, child);
+		node.localPosition = child->localPosition;
+		node.localScale = child->localScale;
+		node.localRotation = child->localRotation;
+		node.entityVersion = child->getTransformVersion();
+		child->parentHandle = parent->getHandle();
+		parent->childCount++;
+		transformNodesChanged = true;
+		addMovedEntity(child);
+	}
+
+	void EntitySystem::updateTransforms() {
+		if (transformNodesChanged) {
+			//detached children leave an empty node
+			std::erase_if(transformNodes, [](const TransformNode& node) {
+				return node.entity == nullptr;
+			});
+			for (int i = 0; i < transformNodes.size(); i++) {
+				transformNodes[i].entity->transformNode = i;
+			}
+			for (auto& node : transformNodes) {
+				node.depth = 0;
+				for (Entity* ent = node.parent; ent && ent->transformNode != -1; ent = transformNodes[ent->transformNode].parent) {
+					node.depth++;
+				}
+			}
+			//the children of a parent have the same depth and end up next to each other
+			std::stable_sort(transformNodes.begin(), transformNodes.end(), [](const TransformNode& a, const TransformNode& b) {
+				if (a.depth != b.depth) {
+					return a.depth < b.depth;
+				}
+				return std::less<Entity*>()(a.parent, b.parent);
+			});
+			for (int i = 0; i < transformNodes.size(); i++) {
+				transformNodes[i].entity->transformNode = i;
+				if (i == 0 || transformNodes[i - 1].parent != transformNodes[i].parent) {
+					transformNodes[i].parent->childNodes = i;
+				}
+			}
+			transformNodesChanged = false;
+		}
+		if (transformNodes.empty()) {
+			return;
+		}
+
+		//entities that moved during the frame, including the ones with a changed local transform
+		dirtyTransformNodes.clear();
+		{
+			std::unique_lock<std::mutex> lock(commandBufferMutex);
+			for (auto& buffer : commandBuffers) {
+				for (Entity* ent : buffer->movedEntities) {
+					if (ent->transformNode != -1) {
+						dirtyTransformNodes.push_back(ent->transformNode);
+					}
+					for (int i = 0; i < ent->childCount; i++) {
+						dirtyTransformNodes.push_back(ent->childNodes + i);
+					}
+				}
+			}
+		}
+		std::make_heap(dirtyTransformNodes.begin(), dirtyTransformNodes.end(), std::greater<int>());
+
+		//nodes are visited in the order of the array, so parents are updated before their children
+		transformUpdateCount++;
+		while (!dirtyTransformNodes.empty()) {
+			std::pop_heap(dirtyTransformNodes.begin(), dirtyTransformNodes.end(), std::greater<int>());
+			TransformNode& node = transformNodes[dirtyTransformNodes.back()];
+			dirtyTransformNodes.pop_back();
+			if (node.updateCount == transformUpdateCount) {
+				continue;
+			}
+			node.updateCount = transformUpdateCount;
+
+			Entity* ent = node.entity;
+			Entity* parent = node.parent;
+			bool localChanged = ent->localPosition != node.localPosition || ent->localScale != node.localScale || ent->localRotation != node.localRotation;
+			if (!localChanged && ent->getTransformVersion() != node.entityVersion) {
+				//the world transform was changed directly
+				toLocal(node.parentPosition, node.parentScale, node.parentRotation, ent);
+				localChanged = true;
+			}
+
+			uint32_t parentVersion = parent->getTransformVersion();
+			if (localChanged || parentVersion != node.parentVersion) {
+				toWorld(parent->position, parent->scale, parent->rotation, ent);
+				node.parentVersion = parentVersion;
+				node.parentPosition = parent->position;
+				node.parentScale = parent->scale;
+				node.parentRotation = parent->rotation;
+				node.localPosition = ent->localPosition;
+				node.localScale = ent->localScale;
+				node.localRotation = ent->localRotation;
+			}
+
+			uint32_t version = ent->getTransformVersion();
+			if (version != node.entityVersion) {
+				node.entityVersion = version;
+				addDirtyTransform(ent);
+			}
+		}
+	}
+
+	void EntitySystem::addDirtyTransform(Entity* ent) {
+		//the children of a moved entity follow it
+		for (int i = 0; i < ent->childCount; i++) {
+			dirtyTransformNodes.push_back(ent->childNodes + i);
+			std::push_heap(dirtyTransformNodes.begin(), dirtyTransformNodes.end(), std::greater<int>());
+		}
+	}
+
+	void EntitySystem::removeFromHierarchy() {
+		//called before the removed entities are destroyed, children of removed entities are detached
+		for (auto& node : transformNodes) {
+			if (!node.entity) {
+				continue;
+			}
+			if (node.entity->removed || node.parent->removed) {
+				node.parent->childCount--;
+				node.entity->parentHandle = EntityHandle();
+				node.entity->transformNode = -1;
+				node.entity = nullptr;
+				transformNodesChanged = true;
+			}
+		}
+	}
+
+	void EntitySystem::sleepUntil(Entity* ent, const std::string& event) {
+		ent->setActive(false);
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingEntities[event].push_back(ent->getHandle());
+	}
+
+	void EntitySystem::wake(const std::string& event) {
+		std::vector<EntityHandle> handles;
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			auto entry = sleepingEntities.find(event);
+			if (entry == sleepingEntities.end()) {
+				return;
+			}
+			handles.swap(entry->second);
+			sleepingEntities.erase(entry);
+		}
+		//the entities are activated in the next updatePending, removed entities have an invalid handle by then
+		addCommand(Command::DEFERRED, nullptr, [this, handles]() {
+			for (auto& handle : handles) {
+				Entity* ent = handle.get();
+				if (ent && !ent->active) {
+					ent->active = true;
+					activeChanges.push_back(ent);
+				}
+			}
+		});
 	}
 
 	void EntitySystem::clear() {
+		{
+			std::unique_lock<std::mutex> lock(commandBufferMutex);
+			for (auto& buffer : commandBuffers) {
+				std::unique_lock<std::mutex> bufferLock(buffer->mutex);
+				for (auto& command : buffer->commands) {
+					if (command.type == Command::ADD_ENTITY) {
+						pendingAdds.push_back(command.entity);
+					}
+				}
+				buffer->commands.clear();
+				buffer->movedEntities.clear();
+			}
+		}
+
 		for (auto& entity : entities) {
 			if (entity) {
 				EntityRef::invalidate(entity);
-				delete entity;
+				destroyEntity(entity);
 				entity = nullptr;
 			}
 		}
@@ -172,14 +990,146 @@ namespace tridot2d {
 		for (auto& entity : pendingAdds) {
 			if (entity) {
 				EntityRef::invalidate(entity);
-				delete entity;
+				destroyEntity(entity);
 				entity = nullptr;
 			}
 		}
 		pendingAdds.clear();
 		pendingRemoves.clear();
+		changedEntities.clear();
+		for (auto& view : views) {
+			view->entities.clear();
+			view->activeCount = 0;
+		}
+		activeCount = 0;
+		activeChanges.clear();
+		movedEntities.clear();
+		transformNodes.clear();
+		transformNodesChanged = false;
+		typeBucketsChanged = true;
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepingEntities.clear();
+		}
+		archetypeByTypes.clear();
+		archetypes.clear();
+	}
+
+	void EntitySystem::destroyEntity(Entity* ent) {
+		if (ent->archetype) {
+			ent->archetype->removeRow(ent->archetypeRow);
+		}
+		Pool* pool = ent->pool;
+		if (pool) {
+			void* memory = dynamic_cast<void*>(ent);
+			ent->~Entity();
+			pool->deallocate(memory);
+		}
+		else {
+			delete ent;
+		}
 	}
 
+	Archetype* EntitySystem::getArchetype(const std::vector<int>& typeIds) {
+		auto i = archetypeByTypes.find(typeIds);
+		if (i != archetypeByTypes.end()) {
+			return i->second;
+		}
+		auto archetype = std::make_shared<Archetype>(typeIds);
+		archetypes.push_back(archetype);
+		archetypeByTypes[typeIds] = archetype.get();
+		return archetype.get();
+	}
 
+	void EntitySystem::addToArchetype(Entity* ent) {
+		//the first component of each type is moved into the archetype, duplicates stay on the heap
+		//components that are still shared with a copy of the entity are copied, if their type can't be copied they stay on the heap as well
+		std::vector<std::shared_ptr<Component>*> stored;
+		std::vector<int> seenTypeIds;
+		for (auto& comp : ent->components) {
+			if (!comp || comp->typeId == -1 || std::find(seenTypeIds.begin(), seenTypeIds.end(), comp->typeId) != seenTypeIds.end()) {
+				continue;
+			}
+			seenTypeIds.push_back(comp->typeId);
+			ComponentType* type = ComponentType::get(comp->typeId);
+			bool shared = comp.use_count() > 1;
+			if (shared ? type->copyConstruct != nullptr : type->moveConstruct != nullptr) {
+				stored.push_back(&comp);
+			}
+		}
+		std::sort(stored.begin(), stored.end(), [](std::shared_ptr<Component>* a, std::shared_ptr<Component>* b) {
+			return (*a)->typeId < (*b)->typeId;
+		});
+
+		std::vector<int> typeIds;
+		for (auto* comp : stored) {
+			typeIds.push_back((*comp)->typeId);
+		}
+
+		Archetype* archetype = getArchetype(typeIds);
+		int row = archetype->addRow(ent);
+		ent->archetype = archetype;
+		ent->archetypeRow = row;
+
+		for (int column = 0; column < stored.size(); column++) {
+			std::shared_ptr<Component>& comp = *stored[column];
+			ComponentType* type = ComponentType::get(comp->typeId);
+			Component* dst = archetype->get(column, row);
+			if (comp.use_count() > 1) {
+				type->copyConstruct(dst, comp.get());
+			}
+			else {
+				type->moveConstruct(dst, comp.get());
+			}
+			dst->entity = ent;
+			ent->relocateComponent(comp.get(), dst);
+		}
+	}
+
+	Component* EntitySystem::addArchetypeComponent(Entity* ent, int typeId, const Component* comp) {
+		ComponentType* type = ComponentType::get(typeId);
+		Archetype* from = ent->archetype;
+		Component* dst = nullptr;
+
+		if (from->getColumn(typeId) != -1) {
+			//duplicate component types are kept on the heap
+			void* memory = ::operator new(type->size, std::align_val_t(type->alignment));
+			type->copyConstruct(memory, comp);
+			dst = (Component*)memory;
+			ent->components.push_back(std::shared_ptr<Component>(dst, [type](Component* ptr) {
+				type->destroy(ptr);
+				::operator delete(ptr, std::align_val_t(type->alignment));
+			}));
+			dst->typeId = typeId;
+		}
+		else {
+			std::vector<int> typeIds = from->typeIds;
+			typeIds.insert(std::lower_bound(typeIds.begin(), typeIds.end(), typeId), typeId);
+			Archetype* to = getArchetype(typeIds);
+
+			int fromRow = ent->archetypeRow;
+			int row = to->addRow(ent);
+			for (int i = 0; i < from->typeIds.size(); i++) {
+				Component* src = from->get(i, fromRow);
+				Component* moved = to->get(to->getColumn(from->typeIds[i]), row);
+				ComponentType::get(from->typeIds[i])->moveConstruct(moved, src);
+				ent->relocateComponent(src, moved);
+			}
+			ent->archetype = to;
+			ent->archetypeRow = row;
+			from->removeRow(fromRow);
+
+			dst = to->get(to->getColumn(typeId), row);
+			type->copyConstruct(dst, comp);
+			ent->components.push_back(storageRef(dst));
+			dst->typeId = typeId;
+			ent->addComponentLookup(dst);
+		}
+
+		dst->entity = ent;
+		ent->onComponentAdded();
+		dst->init();
+		return dst;
+	}
 
 }
\ No newline at end of file
@@ -4,12 +4,19 @@
 
 #pragma once
 
+#include "ComponentType.h"
+#include "Archetype.h"
+#include "EntityHandle.h"
+#include "UpdatePass.h"
+#include "common/Pool.h"
 #include <glm/glm.hpp>
 #include <string>
 #include <unordered_map>
 #include <memory>
 #include <map>
-#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
 
 namespace tridot2d {
 
@@ -21,38 +28,76 @@ namespace tridot2d {
 		virtual void update() {};
 		virtual void preUpdate() {};
 		virtual void init() {};
+
+	private:
+		int typeId = -1;
+		friend class Entity;
+		friend class EntitySystem;
 	};
 
 	class Entity {
 	public:
 		std::vector<std::shared_ptr<Component>> components;
-		bool active = true;
 		class EntitySystem* entitySystem = nullptr;
 
+		//world transform
 		glm::vec2 position = { 0, 0 };
 		glm::vec2 scale = { 1, 1 };
 		float rotation = 0;
 
+		//transform relative to the parent, only used for entities with a parent
+		glm::vec2 localPosition = { 0, 0 };
+		glm::vec2 localScale = { 1, 1 };
+		float localRotation = 0;
+
 		Entity(const glm::vec2 position = { 0, 0 }, const glm::vec2& scale = { 1, 1 }, float rotation = 0)
 			: position(position), scale(scale), rotation(rotation) {}
 
 		Entity(const Entity& ent);
 
-		virtual ~Entity() {}
+		virtual ~Entity();
 
+		//with archetype storage a new component type moves all components of the entity to another row
+		//pointers to them are invalid afterwards, this includes this of a component that calls it from its own update
 		template<typename T>
 		T *addComponent(const T& t = T()) {
-			auto comp = std::make_shared<T>(t);
+			int typeId = ComponentType::getId<T>();
+			if (archetype) {
+				return (T*)addArchetypeComponent(typeId, &t);
+			}
+			auto comp = std::allocate_shared<T>(PoolAllocator<T>(), t);
 			components.push_back(comp);
+			((Component*)comp.get())->typeId = typeId;
 			((Component*)comp.get())->entity = this;
+			addComponentLookup(comp.get());
 			if (entitySystem) {
+				onComponentAdded();
 				((Component*)comp.get())->init();
 			}
 			return comp.get();
 		}
 
+		//returns the first component of exactly type T
 		template<typename T>
 		T* getComponent() {
+			int typeId = ComponentType::getId<T>();
+			if (typeId < ComponentMask::maxTypes) {
+				if (componentMask.test(typeId)) {
+					return (T*)componentLookup[componentMask.rank(typeId)];
+				}
+				return nullptr;
+			}
+			for (auto& comp : components) {
+				if (comp && comp->typeId == typeId) {
+					return (T*)comp.get();
+				}
+			}
+			return nullptr;
+		}
+
+		//returns the first component that is a T or derived from T
+		template<typename T>
+		T* findComponent() {
 			for (auto& comp : components) {
 				T* t = dynamic_cast<T*>(comp.get());
 				if (t) {
@@ -62,6 +107,21 @@ namespace tridot2d {
 			return nullptr;
 		}
 
+		template<typename T>
+		bool hasComponent() {
+			return getComponent<T>() != nullptr;
+		}
+
+		template<typename... T>
+		bool hasComponents() {
+			static const ComponentMask mask = ComponentMask::of<T...>();
+			return componentMask.contains(mask);
+		}
+
+		const ComponentMask& getComponentMask() {
+			return componentMask;
+		}
+
 		virtual void preUpdate() {};
 		virtual void update() {};
 		virtual void postUpdate() {};
@@ -69,19 +129,80 @@ namespace tridot2d {
 
 		void removeEntity();
 
+		bool isActive() {
+			return active;
+		}
+
+		//inactive entities are skipped by update and the update passes
+		//the entity system moves the entity between its active and inactive entities in the next updatePending
+		void setActive(bool active);
+
+		//the handle is created when the entity is added to an entity system, a copy of an entity gets a new handle
+		EntityHandle getHandle();
+
+		//changes when position, scale or rotation changed since the last call, the fields are compared to the values of the last call
+		//a change adds the entity to the moved entities of the entity system
+		//not thread safe, should be called from the thread that updates the entity
+		uint32_t getTransformVersion();
+
+		//set the field and update the transform version right away
+		//direct writes to the fields are only noticed by the next call of getTransformVersion
+		void setPosition(const glm::vec2& position);
+		void setScale(const glm::vec2& scale);
+		void setRotation(float rotation);
+
+		//set the local transform of an entity with a parent, the world transform follows at the end of the update
+		void setLocalPosition(const glm::vec2& localPosition);
+		void setLocalScale(const glm::vec2& localScale);
+		void setLocalRotation(float localRotation);
+
+		//the transform version changed during the last update of the entity system
+		bool hasMoved();
+
+		Entity* getParent();
+
 	private:
+		bool active = true;
 		int entityIndex = -1;
+		EntityHandle handle;
+		Pool* pool = nullptr;
+		Archetype* archetype = nullptr;
+		int archetypeRow = -1;
+		bool removed = false;
+		glm::vec2 trackedPosition = { 0, 0 };
+		glm::vec2 trackedScale = { 1, 1 };
+		float trackedRotation = 0;
+		uint32_t transformVersion = 0;
+		//frame in which the entity was last added to the moved entities
+		uint64_t movedFrame = 0;
+		EntityHandle parentHandle;
+		int childCount = 0;
+		//index in the transform nodes of the entity system, -1 if the entity has no parent
+		int transformNode = -1;
+		//index of the first transform node of the children, the nodes of the children are next to each other
+		int childNodes = -1;
+		//index in the entity list of each view of the entity system, -1 if not in the view
+		std::vector<int> viewIndices;
 		friend class EntitySystem;
+		friend class Archetype;
+		friend class EntityRef;
+
+		//first component of each type ordered by type id, indexed by the rank of the type id in componentMask
+		ComponentMask componentMask;
+		std::vector<Component*> componentLookup;
+
+		Component* addArchetypeComponent(int typeId, const Component* comp);
+		void relocateComponent(Component* from, Component* to);
+		void addComponentLookup(Component* comp);
+		void onComponentAdded();
 	};
 
+	//compatibility wrapper around EntityHandle
 	class EntityRef {
 	public:
-		EntityRef();
+		EntityRef() = default;
 		EntityRef(Entity* ent);
-		EntityRef(const EntityRef& ref);
-		EntityRef(EntityRef&& ref);
-		~EntityRef();
-		void operator=(const EntityRef& ref);
+		EntityRef(EntityHandle handle);
 		void operator=(Entity* ent);
 		bool operator==(Entity* ent);
 		bool operator==(const EntityRef& ref);
@@ -91,19 +212,103 @@ namespace tridot2d {
 		Entity& operator*();
 		Entity* get();
 		void set(Entity *ent);
+		EntityHandle getHandle();
+
+		//invalidates all handles and references to the entity
 		static void invalidate(Entity* ent);
 
 	private:
-		Entity* entity = nullptr;
-		static std::map<Entity*, std::set<EntityRef*>> refs;
+		EntityHandle handle;
+	};
+
+	//entities that have all components of the mask, maintained by the entity system
+	//the active entities are at the front of the list, the inactive ones after them
+	class EntityView {
+	public:
+		int viewId = -1;
+		ComponentMask mask;
+		std::vector<Entity*> entities;
+		int activeCount = 0;
+	};
+
+	template<typename... T>
+	class View {
+	public:
+		View(EntityView* view)
+			: view(view) {}
+
+		std::vector<Entity*>::iterator begin() {
+			return view->entities.begin();
+		}
+
+		std::vector<Entity*>::iterator end() {
+			return view->entities.end();
+		}
+
+		int size() {
+			return view->entities.size();
+		}
+
+		int getActiveCount() {
+			return view->activeCount;
+		}
+
+		//calls the callback with every active entity of the view and its components
+		template<typename Func>
+		void each(Func&& callback) {
+			for (int i = 0; i < view->activeCount; i++) {
+				Entity* entity = view->entities[i];
+				if (entity->isActive()) {
+					callback(entity, *entity->getComponent<T>()...);
+				}
+			}
+		}
+
+	private:
+		EntityView* view;
+	};
+
+	enum class ComponentStorage {
+		//every component is a separate heap allocation owned by its entity
+		DEFAULT,
+		//components are stored in dense per type arrays grouped by the component types of an entity
+		//components are moved when the set of component types of an entity changes,
+		//so pointers to components should not be kept across frames
+		ARCHETYPE,
+	};
+
+	enum class UpdateOrder {
+		//preUpdate, the components and update are called entity by entity
+		ENTITY,
+		//preUpdate of all entities, then the components grouped by type, then update of all entities
+		//types with a static updateAll(std::span<T*>) get all their components in one call
+		//with ComponentStorage::ARCHETYPE, components have to be added with the deferred EntitySystem::addComponent during the update
+		TYPE,
 	};
 
 	class EntitySystem {
 	public:
+		//the active entities are at the front of the list, the inactive ones after them
 		std::vector<Entity*> entities;
 		std::vector<Entity*> pendingRemoves;
 		std::vector<Entity*> pendingAdds;
 
+		//has to be set before entities are added
+		ComponentStorage storage = ComponentStorage::DEFAULT;
+
+		//update passes run on the workers of the task manager, without one they run on the calling thread
+		class TaskManager* taskManager = nullptr;
+
+		UpdateOrder updateOrder = UpdateOrder::ENTITY;
+		//type ids updated first with UpdateOrder::TYPE, the remaining types follow by type id
+		std::vector<int> typeOrder;
+
+		template<typename... T>
+		void setTypeOrder() {
+			typeOrder = { ComponentType::getId<T>()... };
+		}
+
+		EntitySystem();
 		~EntitySystem();
 
 		void updatePending();
@@ -111,18 +316,278 @@ namespace tridot2d {
 		void removeEntity(Entity* ent);
 		void clear();
 
+		int getActiveCount() {
+			return activeCount;
+		}
+
+		//active entities whose transform version changed during the last update, valid until the next update
+		//entities are recorded when their version changes, so the cost depends on the number of moved entities
+		const std::vector<Entity*>& getMovedEntities() {
+			return movedEntities;
+		}
+
+		//the world transform of a child follows its parent, its local transform is relative to the parent
+		//changing the world transform of a child moves it relative to its parent
+		//the current world transform of the child is kept, a parent of nullptr detaches the child
+		void setParent(Entity* child, Entity* parent);
+
+		//recomputes the world transforms of children whose parent or local transform changed, called at the end of update
+		//only the entities that moved during the frame and their descendants are visited
+		//changes have to go through the setters of the entity or be noticed by getTransformVersion
+		void updateTransforms();
+
+		//deactivates the entity until the event is woken
+		void sleepUntil(Entity* ent, const std::string& event);
+		//activates all entities that sleep until the event, can be called from any thread
+		//the entities are activated in the next updatePending on the thread that updates the entity system
+		void wake(const std::string& event);
+
+		//addEntity, removeEntity and the deferred addComponent can be called from any thread
+		//they are recorded in a command buffer of the calling thread and applied in the next updatePending
 		template<typename T>
 		T* addEntity(T* ent) {
-			pendingAdds.push_back(ent);
+			addCommand(Command::ADD_ENTITY, ent);
 			return ent;
 		}
 
 		template<typename T>
 		T *addEntity(const T& t = T()) {
-			T* ent = new T(t);
-			pendingAdds.push_back(ent);
+			Pool* pool = Pool::get<T>();
+			T* ent = new (pool->allocate()) T(t);
+			((Entity*)ent)->pool = pool;
+			addCommand(Command::ADD_ENTITY, ent);
 			return ent;
 		}
+
+		//adds count copies of the prototype, components are cloned and not shared with the prototype
+		//initFn is called with each copy and its index before the copy is added
+		template<typename T, typename Func>
+		void spawn(const T& prototype, int count, Func&& initFn) {
+			if (count <= 0) {
+				return;
+			}
+			Pool* pool = Pool::get<T>();
+			std::vector<void*> blocks(count);
+			pool->allocate(blocks.data(), count);
+			std::vector<Entity*> ents(count);
+			for (int i = 0; i < count; i++) {
+				T* ent = new (blocks[i]) T(prototype);
+				((Entity*)ent)->pool = pool;
+				initFn(ent, i);
+				ents[i] = ent;
+			}
+			addCommands(Command::ADD_ENTITY, ents.data(), count);
+		}
+
+		template<typename T>
+		void spawn(const T& prototype, int count) {
+			spawn(prototype, count, [](T*, int) {});
+		}
+
+		template<typename T>
+		void addComponent(Entity* ent, const T& t = T()) {
+			addCommand(Command::DEFERRED, ent, [ent, t]() {
+				ent->addComponent<T>(t);
+			});
+		}
+
+		//runs the callback in the next updatePending on the thread that updates the entity system
+		void defer(const std::function<void()>& callback);
+
+		//passes run in update() after the pending entities are added and before the entities are updated one by one
+		//structural changes from passes have to go through addEntity and removeEntity
+		UpdatePass& addPass(const std::string& name, const ComponentMask& required, const std::function<void(Entity*)>& callback);
+
+		//calls update() of every component of type T in a pass instead of in the per entity update
+		//only T is declared as written, components that move their entity have to add write<EntityTransform>() to the pass
+		template<typename T>
+		UpdatePass& addPass(const std::string& name = typeid(T).name()) {
+			int typeId = ComponentType::getId<T>();
+			UpdatePass& pass = addPass(name, ComponentMask::of<T>(), [typeId](Entity* entity) {
+				for (auto& comp : entity->components) {
+					if (comp && comp->typeId == typeId) {
+						comp->update();
+					}
+				}
+			});
+			pass.write<T>();
+			pass.updates.set(typeId);
+			return pass;
+		}
+
+		//calls the callback with the entity and its components for every entity with the components T...
+		template<typename... T, typename Func>
+		UpdatePass& addPass(const std::string& name, Func callback) {
+			UpdatePass& pass = addPass(name, ComponentMask::of<T...>(), [callback](Entity* entity) {
+				callback(entity, *entity->getComponent<T>()...);
+			});
+			pass.write<T...>();
+			return pass;
+		}
+
+		void removePass(const std::string& name);
+
+		//index of the stage the pass runs in, passes of the same stage run concurrently, -1 if there is no such pass
+		int getPassStage(const std::string& name);
+
+		//the entity lists of views are updated in updatePending, so iterating a view only visits matching entities
+		//views should be created from the main thread
+		template<typename... T>
+		View<T...> view() {
+			static const ComponentMask mask = ComponentMask::of<T...>();
+			return View<T...>(getView(mask));
+		}
+
+		EntityView* getView(const ComponentMask& mask);
+
+		//calls the callback for every component of type T, including components of inactive entities
+		//with archetype storage the components are visited in memory order
+		template<typename T, typename Func>
+		void each(Func&& callback) {
+			int typeId = ComponentType::getId<T>();
+			if (storage == ComponentStorage::ARCHETYPE) {
+				for (auto& archetype : archetypes) {
+					int column = archetype->getColumn(typeId);
+					if (column != -1) {
+						archetype->each<T>(column, callback);
+					}
+				}
+			}
+			else {
+				for (auto* entity : entities) {
+					T* comp = entity->getComponent<T>();
+					if (comp) {
+						callback(*comp);
+					}
+				}
+			}
+		}
+
+	private:
+		std::vector<std::shared_ptr<Archetype>> archetypes;
+		std::map<std::vector<int>, Archetype*> archetypeByTypes;
+
+		class Command {
+		public:
+			enum Type {
+				ADD_ENTITY,
+				REMOVE_ENTITY,
+				SET_ACTIVE,
+				DEFERRED,
+			};
+			Type type = ADD_ENTITY;
+			uint64_t sortKey = 0;
+			Entity* entity = nullptr;
+			std::function<void()> callback;
+		};
+
+		class CommandBuffer {
+		public:
+			std::mutex mutex;
+			std::vector<Command> commands;
+			//index of the buffer in commandBuffers
+			uint64_t threadIndex = 0;
+			//number of commands recorded outside of passes by a thread that doesn't own the entity system
+			uint64_t sequence = 0;
+			//entities moved by this thread in the current frame, only used by this thread until the end of update
+			std::vector<Entity*> movedEntities;
+		};
+
+		class ThreadCommandBuffer {
+		public:
+			uint64_t systemId = 0;
+			CommandBuffer* buffer = nullptr;
+			std::weak_ptr<CommandBuffer> reference;
+		};
+
+		//command buffers of all threads, in the order the threads first used the entity system
+		std::vector<std::shared_ptr<CommandBuffer>> commandBuffers;
+		//buffers of the current thread by system id, entries of destroyed entity systems are dropped when a buffer is added
+		static thread_local std::vector<ThreadCommandBuffer> threadCommandBuffers;
+		std::mutex commandBufferMutex;
+		std::vector<Command> mergedCommands;
+		std::vector<Entity*> activeChanges;
+		int activeCount = 0;
+
+		std::unordered_map<std::string, std::vector<EntityHandle>> sleepingEntities;
+		std::mutex sleepMutex;
+		uint64_t systemId = 0;
+		//read by threads that record commands
+		std::atomic<std::thread::id> ownerThread;
+
+		std::vector<std::shared_ptr<EntityView>> views;
+		std::vector<Entity*> changedEntities;
+		std::mutex changedMutex;
+
+		class PassJob {
+		public:
+			UpdatePass* pass = nullptr;
+			EntityView* view = nullptr;
+			int begin = 0;
+			int end = 0;
+			uint64_t sortKey = 0;
+		};
+		std::vector<std::shared_ptr<UpdatePass>> passes;
+		std::vector<std::vector<std::pair<UpdatePass*, EntityView*>>> passStages;
+		std::vector<PassJob> passJobs;
+		ComponentMask passTypes;
+		bool passesChanged = false;
+
+		void updateViews(Entity* ent);
+		void removeFromViews(Entity* ent);
+		void updateActive(Entity* ent);
+		void updateByType();
+		void updateMovedEntities();
+		void addMovedEntity(Entity* ent);
+
+		std::vector<Entity*> movedEntities;
+		uint64_t frameCount = 0;
+
+		//an entity with a parent, the transforms of the last update are kept to detect changes
+		class TransformNode {
+		public:
+			Entity* entity = nullptr;
+			Entity* parent = nullptr;
+			int depth = 0;
+			uint32_t entityVersion = 0;
+			uint32_t parentVersion = 0;
+			glm::vec2 parentPosition = { 0, 0 };
+			glm::vec2 parentScale = { 1, 1 };
+			float parentRotation = 0;
+			glm::vec2 localPosition = { 0, 0 };
+			glm::vec2 localScale = { 1, 1 };
+			float localRotation = 0;
+			//value of transformUpdateCount when the node was last visited
+			uint64_t updateCount = 0;
+		};
+		//ordered by depth and then by parent, parents are updated before their children
+		std::vector<TransformNode> transformNodes;
+		bool transformNodesChanged = false;
+		//min heap of the indices of the nodes to visit
+		std::vector<int> dirtyTransformNodes;
+		uint64_t transformUpdateCount = 0;
+
+		void addDirtyTransform(Entity* ent);
+
+		void removeFromHierarchy();
+
+		std::vector<std::vector<Component*>> typeBuckets;
+		bool typeBucketsChanged = true;
+		std::vector<int> typeUpdateOrder;
+		void updatePassStages();
+		void updatePasses();
+		void runPassJob(const PassJob& job);
+
+		CommandBuffer* getCommandBuffer();
+		uint64_t getCommandSortKey(CommandBuffer* buffer, int count);
+		void addCommand(Command::Type type, Entity* ent, const std::function<void()>& callback = nullptr);
+		void addCommands(Command::Type type, Entity** ents, int count);
+		void mergeCommands();
+		void destroyEntity(Entity* ent);
+		Archetype* getArchetype(const std::vector<int>& typeIds);
+		void addToArchetype(Entity* ent);
+		Component* addArchetypeComponent(Entity* ent, int typeId, const Component* comp);
+		friend class Entity;
 	};
 
 }
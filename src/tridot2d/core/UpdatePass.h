@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2025 Julian Hinxlage. All rights reserved.
+//
+
+#pragma once
+
+#include "ComponentType.h"
+#include <functional>
+#include <string>
+
+namespace tridot2d {
+
+	//access token for the position, scale and rotation of entities
+	class EntityTransform {};
+
+	//update callback for all entities with the required components
+	//passes that don't conflict in their declared access run concurrently,
+	//the entities of a parallel pass are split into chunks of grainSize that run concurrently as well
+	class UpdatePass {
+	public:
+		std::string name;
+		ComponentMask required;
+		ComponentMask reads;
+		ComponentMask writes;
+		//component types whose update() is called by this pass instead of the per entity update
+		ComponentMask updates;
+		bool parallel = true;
+		int grainSize = 1024;
+		std::function<void(class Entity*)> callback;
+
+		template<typename... T>
+		UpdatePass& read() {
+			(reads.set(ComponentType::getId<T>()), ...);
+			return *this;
+		}
+
+		template<typename... T>
+		UpdatePass& write() {
+			(writes.set(ComponentType::getId<T>()), ...);
+			return *this;
+		}
+
+		//all entities are processed by a single task
+		UpdatePass& serial() {
+			parallel = false;
+			return *this;
+		}
+
+		UpdatePass& grain(int grainSize) {
+			this->grainSize = grainSize;
+			return *this;
+		}
+
+		bool conflicts(const UpdatePass& pass) const {
+			return writes.intersects(pass.writes) || writes.intersects(pass.reads) || reads.intersects(pass.writes);
+		}
+	};
+
+}
@@ -4,6 +4,7 @@
 
 #include "BroadPhase.h"
 #include "PhysicsSystem.h"
+#include <algorithm>
 
 namespace tridot2d {
     
@@ -137,4 +138,412 @@ namespace tridot2d {
 		}
 	}
 
+	static float perimeter(const glm::vec2& min, const glm::vec2& max) {
+		return 2.0f * (max.x - min.x + max.y - min.y);
+	}
+
+	static bool overlaps(const glm::vec2& minA, const glm::vec2& maxA, const glm::vec2& minB, const glm::vec2& maxB) {
+		return minA.x <= maxB.x && minB.x <= maxA.x && minA.y <= maxB.y && minB.y <= maxA.y;
+	}
+
+	static bool contains(const glm::vec2& outerMin, const glm::vec2& outerMax, const glm::vec2& min, const glm::vec2& max) {
+		return outerMin.x <= min.x && outerMin.y <= min.y && max.x <= outerMax.x && max.y <= outerMax.y;
+	}
+
+	DynamicTreeBroadPhase::DynamicTreeBroadPhase(float margin)
+		: margin(margin) {
+	}
+
+	void DynamicTreeBroadPhase::clearBodies() {
+		nodes.clear();
+		leafByBodyIndex.clear();
+		root = -1;
+		freeList = -1;
+	}
+
+	void DynamicTreeBroadPhase::updateBody(Body* body) {
+		if (leafByBodyIndex.size() <= body->index) {
+			leafByBodyIndex.resize(body->index + 1, -1);
+		}
+
+		glm::vec2 min = body->position;
+		glm::vec2 max = body->position;
+		if (body->shape) {
+			body->shape->getBounds(body, min, max);
+		}
+
+		int leaf = leafByBodyIndex[body->index];
+		if (leaf != -1) {
+			Node& node = nodes[leaf];
+			//the enlarged bounds are kept while they contain the body and are not much larger than needed
+			glm::vec2 largeMargin = glm::vec2(margin * 4);
+			if (contains(node.min, node.max, min, max) && contains(min - largeMargin, max + largeMargin, node.min, node.max)) {
+				return;
+			}
+			removeLeaf(leaf);
+		}
+		else {
+			leaf = allocateNode();
+			leafByBodyIndex[body->index] = leaf;
+		}
+
+		Node& node = nodes[leaf];
+		node.min = min - glm::vec2(margin);
+		node.max = max + glm::vec2(margin);
+		node.body = body;
+		node.left = -1;
+		node.right = -1;
+		node.height = 0;
+		insertLeaf(leaf);
+	}
+
+	void DynamicTreeBroadPhase::removeBody(Body* body) {
+		if (leafByBodyIndex.size() <= body->index) {
+			return;
+		}
+		int leaf = leafByBodyIndex[body->index];
+		if (leaf != -1) {
+			removeLeaf(leaf);
+			freeNode(leaf);
+			leafByBodyIndex[body->index] = -1;
+		}
+	}
+
+	void DynamicTreeBroadPhase::each(const std::function<void(Body*, Body*)>& callback) {
+		for (int i = 0; i < leafByBodyIndex.size(); i++) {
+			int leaf = leafByBodyIndex[i];
+			if (leaf == -1) {
+				continue;
+			}
+			Body* body = nodes[leaf].body;
+			glm::vec2 min = nodes[leaf].min;
+			glm::vec2 max = nodes[leaf].max;
+
+			//every pair is reported once, by the body with the lower index
+			stack.clear();
+			stack.push_back(root);
+			while (!stack.empty()) {
+				int index = stack.back();
+				stack.pop_back();
+				Node& node = nodes[index];
+				if (!overlaps(node.min, node.max, min, max)) {
+					continue;
+				}
+				if (node.left == -1) {
+					if (node.body->index > i) {
+						callback(body, node.body);
+					}
+				}
+				else {
+					stack.push_back(node.left);
+					stack.push_back(node.right);
+				}
+			}
+		}
+	}
+
+	int DynamicTreeBroadPhase::getHeight() {
+		return root == -1 ? 0 : nodes[root].height;
+	}
+
+	int DynamicTreeBroadPhase::allocateNode() {
+		if (freeList == -1) {
+			nodes.emplace_back();
+			return (int)nodes.size() - 1;
+		}
+		int node = freeList;
+		freeList = nodes[node].parent;
+		nodes[node] = Node();
+		return node;
+	}
+
+	void DynamicTreeBroadPhase::freeNode(int node) {
+		nodes[node].body = nullptr;
+		nodes[node].parent = freeList;
+		freeList = node;
+	}
+
+	void DynamicTreeBroadPhase::insertLeaf(int leaf) {
+		if (root == -1) {
+			root = leaf;
+			nodes[leaf].parent = -1;
+			return;
+		}
+
+		//find the sibling with the lowest cost, the cost is the increase of the perimeters
+		glm::vec2 leafMin = nodes[leaf].min;
+		glm::vec2 leafMax = nodes[leaf].max;
+		int index = root;
+		while (nodes[index].left != -1) {
+			Node& node = nodes[index];
+			float area = perimeter(node.min, node.max);
+			float combinedArea = perimeter(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+			//cost of a new parent for this node and the leaf, and the cost of pushing the leaf further down
+			float cost = 2.0f * combinedArea;
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float childCosts[2];
+			int children[2] = { node.left, node.right };
+			for (int i = 0; i < 2; i++) {
+				Node& child = nodes[children[i]];
+				float childArea = perimeter(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+				if (child.left != -1) {
+					childArea -= perimeter(child.min, child.max);
+				}
+				childCosts[i] = childArea + inheritanceCost;
+			}
+
+			if (cost < childCosts[0] && cost < childCosts[1]) {
+				break;
+			}
+			index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = allocateNode();
+		Node& parent = nodes[newParent];
+		parent.parent = oldParent;
+		parent.min = glm::min(nodes[sibling].min, leafMin);
+		parent.max = glm::max(nodes[sibling].max, leafMax);
+		parent.height = nodes[sibling].height + 1;
+		parent.left = sibling;
+		parent.right = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent != -1) {
+			if (nodes[oldParent].left == sibling) {
+				nodes[oldParent].left = newParent;
+			}
+			else {
+				nodes[oldParent].right = newParent;
+			}
+		}
+		else {
+			root = newParent;
+		}
+
+		refit(nodes[leaf].parent);
+	}
+
+	void DynamicTreeBroadPhase::removeLeaf(int leaf) {
+		if (leaf == root) {
+			root = -1;
+			return;
+		}
+
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+		if (grandParent != -1) {
+			if (nodes[grandParent].left == parent) {
+				nodes[grandParent].left = sibling;
+			}
+			else {
+				nodes[grandParent].right = sibling;
+			}
+			nodes[sibling].parent = grandParent;
+			freeNode(parent);
+			refit(grandParent);
+		}
+		else {
+			root = sibling;
+			nodes[sibling].parent = -1;
+			freeNode(parent);
+		}
+	}
+
+	void DynamicTreeBroadPhase::refit(int index) {
+		while (index != -1) {
+			index = balance(index);
+			Node& node = nodes[index];
+			Node& left = nodes[node.left];
+			Node& right = nodes[node.right];
+			node.height = 1 + std::max(left.height, right.height);
+			node.min = glm::min(left.min, right.min);
+			node.max = glm::max(left.max, right.max);
+			index = node.parent;
+		}
+	}
+
+	int DynamicTreeBroadPhase::balance(int a) {
+		Node& nodeA = nodes[a];
+		if (nodeA.left == -1 || nodeA.height < 2) {
+			return a;
+		}
+
+		int b = nodeA.left;
+		int c = nodeA.right;
+		Node& nodeB = nodes[b];
+		Node& nodeC = nodes[c];
+		int difference = nodeC.height - nodeB.height;
+		if (difference >= -1 && difference <= 1) {
+			return a;
+		}
+
+		//the higher child replaces a, a takes the lower grandchild of the higher child
+		int up = difference > 1 ? c : b;
+		int down = difference > 1 ? b : c;
+		Node& nodeUp = nodes[up];
+		Node& nodeDown = nodes[down];
+		int f = nodeUp.left;
+		int g = nodeUp.right;
+		Node& nodeF = nodes[f];
+		Node& nodeG = nodes[g];
+
+		nodeUp.left = a;
+		nodeUp.parent = nodeA.parent;
+		nodeA.parent = up;
+		if (nodeUp.parent != -1) {
+			if (nodes[nodeUp.parent].left == a) {
+				nodes[nodeUp.parent].left = up;
+			}
+			else {
+				nodes[nodeUp.parent].right = up;
+			}
+		}
+		else {
+			root = up;
+		}
+
+		int keep = nodeF.height > nodeG.height ? f : g;
+		int move = nodeF.height > nodeG.height ? g : f;
+		Node& nodeKeep = nodes[keep];
+		Node& nodeMove = nodes[move];
+		nodeUp.right = keep;
+		if (difference > 1) {
+			nodeA.right = move;
+		}
+		else {
+			nodeA.left = move;
+		}
+		nodeMove.parent = a;
+
+		nodeA.min = glm::min(nodeDown.min, nodeMove.min);
+		nodeA.max = glm::max(nodeDown.max, nodeMove.max);
+		nodeA.height = 1 + std::max(nodeDown.height, nodeMove.height);
+		nodeUp.min = glm::min(nodeA.min, nodeKeep.min);
+		nodeUp.max = glm::max(nodeA.max, nodeKeep.max);
+		nodeUp.height = 1 + std::max(nodeA.height, nodeKeep.height);
+		return up;
+	}
+
+	SweepAndPruneBroadPhase::SweepAndPruneBroadPhase(int axis)
+		: axis(axis) {
+	}
+
+	void SweepAndPruneBroadPhase::clearBodies() {
+		entries.clear();
+		entryByBodyIndex.clear();
+		sortedCount = 0;
+		removedCount = 0;
+	}
+
+	void SweepAndPruneBroadPhase::updateBody(Body* body) {
+		if (entryByBodyIndex.size() <= body->index) {
+			entryByBodyIndex.resize(body->index + 1, -1);
+		}
+
+		int index = entryByBodyIndex[body->index];
+		if (index == -1) {
+			index = (int)entries.size();
+			entries.emplace_back();
+			entryByBodyIndex[body->index] = index;
+		}
+
+		Entry& entry = entries[index];
+		entry.body = body;
+		entry.min = body->position;
+		entry.max = body->position;
+		if (body->shape) {
+			body->shape->getBounds(body, entry.min, entry.max);
+		}
+	}
+
+	void SweepAndPruneBroadPhase::removeBody(Body* body) {
+		if (entryByBodyIndex.size() <= body->index) {
+			return;
+		}
+		int index = entryByBodyIndex[body->index];
+		if (index != -1) {
+			entries[index].body = nullptr;
+			entryByBodyIndex[body->index] = -1;
+			removedCount++;
+		}
+	}
+
+	void SweepAndPruneBroadPhase::each(const std::function<void(Body*, Body*)>& callback) {
+		sort();
+
+		int other = 1 - axis;
+		int count = (int)entries.size();
+		for (int i = 0; i < count; i++) {
+			Entry& a = entries[i];
+			for (int j = i + 1; j < count; j++) {
+				Entry& b = entries[j];
+				if (b.min[axis] > a.max[axis]) {
+					break;
+				}
+				if (a.min[other] <= b.max[other] && b.min[other] <= a.max[other]) {
+					callback(a.body, b.body);
+				}
+			}
+		}
+	}
+
+	void SweepAndPruneBroadPhase::sort() {
+		bool moved = false;
+
+		if (removedCount > 0) {
+			int count = 0;
+			int sorted = 0;
+			for (int i = 0; i < entries.size(); i++) {
+				if (entries[i].body) {
+					if (i < sortedCount) {
+						sorted++;
+					}
+					entries[count++] = entries[i];
+				}
+			}
+			entries.resize(count);
+			sortedCount = sorted;
+			removedCount = 0;
+			moved = true;
+		}
+
+		//the previous order is almost sorted, so only a few entries move
+		for (int i = 1; i < sortedCount; i++) {
+			Entry entry = entries[i];
+			int j = i;
+			for (; j > 0 && entries[j - 1].min[axis] > entry.min[axis]; j--) {
+				entries[j] = entries[j - 1];
+				entryByBodyIndex[entries[j].body->index] = j;
+			}
+			if (j != i) {
+				entries[j] = entry;
+				entryByBodyIndex[entry.body->index] = j;
+			}
+		}
+
+		//new entries can be anywhere, an insertion sort would move most entries for each of them
+		if (sortedCount < entries.size()) {
+			auto less = [&](const Entry& a, const Entry& b) {
+				return a.min[axis] < b.min[axis];
+			};
+			std::sort(entries.begin() + sortedCount, entries.end(), less);
+			std::inplace_merge(entries.begin(), entries.begin() + sortedCount, entries.end(), less);
+			sortedCount = (int)entries.size();
+			moved = true;
+		}
+
+		if (moved) {
+			for (int i = 0; i < entries.size(); i++) {
+				entryByBodyIndex[entries[i].body->index] = i;
+			}
+		}
+	}
+
 }
@@ -10,6 +10,17 @@
 
 namespace tridot2d {
 
+	enum class BroadPhaseType {
+		//every body against every other body
+		EACH,
+		//fixed grid of 50x50 cells of size 2 centered on the origin, bodies outside are tested against everything at the border
+		STATIC_GRID,
+		//tree of enlarged bounds that is updated as bodies move, for unbounded levels and bodies of very different sizes
+		DYNAMIC_TREE,
+		//bodies sorted along the x axis, for levels that are much wider than high
+		SWEEP_AND_PRUNE,
+	};
+
 	class BroadPhase {
 	public:
 		class PhysicsSystem* physics = nullptr;
@@ -54,4 +65,76 @@ namespace tridot2d {
 		void eachCell(Cell &a, Cell &b, const std::function<void(Body*, Body*)>& callback);
 	};
 
+	//bounding volume hierarchy over the bounds of the bodies, works for worlds of any size and mixed body sizes
+	//the bounds in the tree are enlarged by margin, so bodies that move a little do not change the tree
+	class DynamicTreeBroadPhase : public BroadPhase {
+	public:
+		DynamicTreeBroadPhase(float margin = 0.1f);
+
+		void clearBodies() override;
+		void updateBody(Body* body) override;
+		void removeBody(Body* body) override;
+		void each(const std::function<void(Body*, Body*)>& callback) override;
+
+		int getHeight();
+
+	private:
+		class Node {
+		public:
+			glm::vec2 min = { 0, 0 };
+			glm::vec2 max = { 0, 0 };
+			//next free node for free nodes
+			int parent = -1;
+			int left = -1;
+			int right = -1;
+			//0 for leaves
+			int height = 0;
+			Body* body = nullptr;
+		};
+		std::vector<Node> nodes;
+		int root = -1;
+		int freeList = -1;
+		float margin = 0;
+		std::vector<int> leafByBodyIndex;
+		std::vector<int> stack;
+
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		//recalculates bounds and height from node up to the root
+		void refit(int node);
+		int balance(int node);
+	};
+
+	//bodies sorted by the minimum of their bounds along one axis, pairs are found by sweeping along that axis
+	//the order is updated with an insertion sort, which is fast when bodies move little between steps
+	class SweepAndPruneBroadPhase : public BroadPhase {
+	public:
+		//0 for the x axis, 1 for the y axis
+		SweepAndPruneBroadPhase(int axis = 0);
+
+		void clearBodies() override;
+		void updateBody(Body* body) override;
+		void removeBody(Body* body) override;
+		void each(const std::function<void(Body*, Body*)>& callback) override;
+
+	private:
+		class Entry {
+		public:
+			glm::vec2 min = { 0, 0 };
+			glm::vec2 max = { 0, 0 };
+			//nullptr for removed bodies until the entries are compacted
+			Body* body = nullptr;
+		};
+		std::vector<Entry> entries;
+		std::vector<int> entryByBodyIndex;
+		//entries after sortedCount were added since the last sort
+		int sortedCount = 0;
+		int removedCount = 0;
+		int axis = 0;
+
+		void sort();
+	};
+
 }
@@ -6,14 +6,31 @@
 
 namespace tridot2d {
 	
-	void PhysicsSystem::init() {
-		broadPhase = std::make_shared<StaticGridBroadPhase>(glm::vec2(2, 2), 50, 50);
-		broadPhase->physics = this;
+	void PhysicsSystem::init(BroadPhaseType broadPhaseType) {
+		switch (broadPhaseType) {
+		case BroadPhaseType::EACH:
+			setBroadPhase(std::make_shared<EachBroadPhase>());
+			break;
+		case BroadPhaseType::DYNAMIC_TREE:
+			setBroadPhase(std::make_shared<DynamicTreeBroadPhase>());
+			break;
+		case BroadPhaseType::SWEEP_AND_PRUNE:
+			setBroadPhase(std::make_shared<SweepAndPruneBroadPhase>());
+			break;
+		default:
+			setBroadPhase(std::make_shared<StaticGridBroadPhase>(glm::vec2(2, 2), 50, 50));
+			break;
+		}
 		solver = std::make_shared<EulerSolver>();
 		solver->physics = this;
 		defaultShape = std::make_shared<BoxShape>();
 	}
 
+	void PhysicsSystem::setBroadPhase(const std::shared_ptr<BroadPhase>& broadPhase) {
+		this->broadPhase = broadPhase;
+		broadPhase->physics = this;
+	}
+
 	void PhysicsSystem::update(float deltaTime, int subSteps) {
 		for (int i = 0; i < subSteps; i++) {
 			step(deltaTime / subSteps);
@@ -16,7 +16,9 @@ namespace tridot2d {
 	public:
 		std::shared_ptr<Shape> defaultShape;
 
-		void init();
+		void init(BroadPhaseType broadPhaseType = BroadPhaseType::STATIC_GRID);
+		//replaces the broad phase, the bodies are added to it on the next step
+		void setBroadPhase(const std::shared_ptr<BroadPhase>& broadPhase);
 		void update(float deltaTime, int subSteps);
 		void step(float deltaTime);
 
@@ -15,11 +15,22 @@ namespace tridot2d {
 	public:
 		Body* body = nullptr;
 		float mass = 1;
+		//transform version of the entity when the body and the entity were last synced
+		uint32_t syncedVersion = 0;
 
 		RigidBody(float mass = 1) {
 			this->mass = mass;
 		}
 
+		//a copy creates its own body on init
+		RigidBody(const RigidBody& rigidBody)
+			: Component(rigidBody), mass(rigidBody.mass) {}
+
+		RigidBody(RigidBody&& rigidBody)
+			: Component(rigidBody), body(rigidBody.body), mass(rigidBody.mass), syncedVersion(rigidBody.syncedVersion) {
+			rigidBody.body = nullptr;
+		}
+
 		~RigidBody() {
 			if (body) {
 				Singleton::get<PhysicsSystem>()->removeBody(body);
@@ -41,12 +52,21 @@ namespace tridot2d {
 			body->rotation = entity->rotation;
 			body->scale = entity->scale;
 			body->entity = entity;
+			syncedVersion = entity->getTransformVersion();
 		}
 
 		void update() override {
-			entity->position = body->position;
-			entity->rotation = body->rotation;
-			body->scale = entity->scale;
+			if (entity->getTransformVersion() != syncedVersion) {
+				//the entity was moved by something else than the body
+				body->position = entity->position;
+				body->rotation = entity->rotation;
+				body->scale = entity->scale;
+			}
+			else if (body->position != entity->position || body->rotation != entity->rotation) {
+				entity->setPosition(body->position);
+				entity->setRotation(body->rotation);
+			}
+			syncedVersion = entity->getTransformVersion();
 		}
 	};
 
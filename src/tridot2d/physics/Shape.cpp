@@ -60,6 +60,18 @@ namespace tridot2d {
 		return false;
 	}
 
+	void Shape::getBounds(Body* body, glm::vec2& min, glm::vec2& max) {
+		glm::vec2 halfSize = glm::abs(body->scale) * 0.5f;
+		min = body->position + offset - halfSize;
+		max = body->position + offset + halfSize;
+	}
+
+	void BoxShape::getBounds(Body* body, glm::vec2& min, glm::vec2& max) {
+		glm::vec2 size = glm::abs(halfSize * body->scale);
+		min = body->position + offset - size;
+		max = body->position + offset + size;
+	}
+
     bool BoxShape::check(Body* body, Body* otherBody, Shape* otherShape, Manifold* result) {
 		if (otherShape && otherShape->type == ShapeType::BOX) {
 			return checkBoxBox(this, body, (BoxShape*)otherShape, otherBody, result);
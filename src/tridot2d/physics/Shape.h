@@ -21,6 +21,8 @@ namespace tridot2d {
 		ShapeType type;
 		glm::vec2 offset = { 0, 0 };
 		virtual bool check(Body *body, Body *otherBody, Shape* otherShape, Manifold* result) { return false; };
+		//axis aligned bounds of the shape on the body
+		virtual void getBounds(Body* body, glm::vec2& min, glm::vec2& max);
 	};
 
 	class BoxShape : public Shape {
@@ -32,6 +34,7 @@ namespace tridot2d {
 		}
 
 		bool check(Body* body, Body* otherBody, Shape* otherShape, Manifold* result) override;
+		void getBounds(Body* body, glm::vec2& min, glm::vec2& max) override;
 	};
 
 }
@@ -91,6 +91,19 @@ namespace tridot2d {
 		i.coordsBR = coords2;
 	}
 
+	void Renderer2D::submitQuadAxes(glm::vec2 pos, glm::vec2 axisX, glm::vec2 axisY, float depth, Texture* texture, Color color, const glm::vec2& coords1, const glm::vec2& coords2) {
+		QuadInstance& i = submit(InstanceType::QUAD).quad;
+		i.position = pos;
+		i.hasAxes = true;
+		i.axisX = axisX;
+		i.axisY = axisY;
+		i.depth = depth;
+		i.color = color;
+		i.texture = texture;
+		i.coordsTL = coords1;
+		i.coordsBR = coords2;
+	}
+
 	void Renderer2D::submitCircle(glm::vec2 pos, glm::vec2 scale, float rotation, float depth, Texture* texture, Color color, const glm::vec2& coords1, const glm::vec2& coords2) {
 		QuadInstance& i = submit(InstanceType::QUAD).quad;
 		i.position = pos;
@@ -166,13 +179,21 @@ namespace tridot2d {
 			case InstanceType::QUAD: {
 				auto& i = it.quad;
 
-				i.scale *= 0.5f;
-				v1.position = glm::vec3(-i.scale.x, -i.scale.y, 0);
-				v2.position = glm::vec3(+i.scale.x, -i.scale.y, 0);
-				v3.position = glm::vec3(+i.scale.x, +i.scale.y, 0);
-				v4.position = glm::vec3(-i.scale.x, +i.scale.y, 0);
+				if (i.hasAxes) {
+					v1.position = glm::vec3(-i.axisX - i.axisY, 0);
+					v2.position = glm::vec3(i.axisX - i.axisY, 0);
+					v3.position = glm::vec3(i.axisX + i.axisY, 0);
+					v4.position = glm::vec3(-i.axisX + i.axisY, 0);
+				}
+				else {
+					i.scale *= 0.5f;
+					v1.position = glm::vec3(-i.scale.x, -i.scale.y, 0);
+					v2.position = glm::vec3(+i.scale.x, -i.scale.y, 0);
+					v3.position = glm::vec3(+i.scale.x, +i.scale.y, 0);
+					v4.position = glm::vec3(-i.scale.x, +i.scale.y, 0);
+				}
 
-				if (i.rotation != 0) {
+				if (!i.hasAxes && i.rotation != 0) {
 					float sin = glm::sin(i.rotation);
 					float cos = glm::cos(i.rotation);
 					v1.position = glm::vec3(v1.position.x * cos - v1.position.y * sin, v1.position.x * sin + v1.position.y * cos, v1.position.z);
@@ -36,6 +36,11 @@ namespace tridot2d {
 			Texture* texture2 = nullptr;
 			glm::vec2 coordsTL2 = { 0, 0 };
 			glm::vec2 coordsBR2 = { 1, 1 };
+
+			//half extents of the quad already scaled and rotated, used instead of scale and rotation if set
+			bool hasAxes = false;
+			glm::vec2 axisX = { 0, 0 };
+			glm::vec2 axisY = { 0, 0 };
 		};
 
 		struct LineInstance : public BaseInstance {
@@ -69,6 +74,7 @@ namespace tridot2d {
 		void end();
 
 		void submitQuad(glm::vec2 pos, glm::vec2 scale, float rotation = 0, float depth = 0, Texture* texture = nullptr, Color color = color::white, const glm::vec2& coords1 = { 0, 0 }, const glm::vec2& coords2 = { 1, 1 });
+		void submitQuadAxes(glm::vec2 pos, glm::vec2 axisX, glm::vec2 axisY, float depth = 0, Texture* texture = nullptr, Color color = color::white, const glm::vec2& coords1 = { 0, 0 }, const glm::vec2& coords2 = { 1, 1 });
 		void submitCircle(glm::vec2 pos, glm::vec2 scale, float rotation = 0, float depth = 0, Texture* texture = nullptr, Color color = color::white, const glm::vec2& coords1 = { 0, 0 }, const glm::vec2& coords2 = { 1, 1 });
 		void submitLine(glm::vec2 p1, glm::vec2 p2, float depth = 0, Color color = color::white, float thickness1 = 1, float thickness2 = 1);
 
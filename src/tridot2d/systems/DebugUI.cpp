@@ -5,6 +5,7 @@
 #include "DebugUI.h"
 #include "Window.h"
 #include "common/Singleton.h"
+#include "common/Pool.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -84,6 +85,9 @@ namespace tridot2d {
 
 	void DebugUI::endFrame() {
 		if (inFrame) {
+			if (showPoolStats) {
+				drawPoolStats();
+			}
 			ImGui::Render();
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -109,4 +113,38 @@ namespace tridot2d {
 		return inFrame;
 	}
 
+	void DebugUI::drawPoolStats() {
+		if (!inFrame) {
+			return;
+		}
+		if (ImGui::Begin("Pools")) {
+			if (ImGui::BeginTable("pools", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Sortable)) {
+				ImGui::TableSetupColumn("Name");
+				ImGui::TableSetupColumn("Size");
+				ImGui::TableSetupColumn("Live");
+				ImGui::TableSetupColumn("Peak");
+				ImGui::TableSetupColumn("Capacity");
+				ImGui::TableSetupColumn("Reused");
+				ImGui::TableHeadersRow();
+				for (auto& stats : Pool::getAllStats()) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(stats.name.c_str());
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", (int)stats.elementSize);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", stats.live);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", stats.peak);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", stats.capacity);
+					ImGui::TableNextColumn();
+					ImGui::Text("%llu / %llu", (unsigned long long)stats.reuses, (unsigned long long)stats.allocations);
+				}
+				ImGui::EndTable();
+			}
+		}
+		ImGui::End();
+	}
+
 }
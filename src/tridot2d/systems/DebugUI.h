@@ -9,6 +9,8 @@ namespace tridot2d {
 	class DebugUI {
 	public:
 		bool active = false;
+		//draws the pool statistics window at the end of every debug ui frame
+		bool showPoolStats = true;
 
 		void init();
 		void beginFrame();
@@ -16,6 +18,9 @@ namespace tridot2d {
 		void shutdown();
 		bool isInFrame();
 
+		//window with the statistics of all allocation pools
+		void drawPoolStats();
+
 	private:
 		void* imguiContext = nullptr;
 		bool inFrame = false;
@@ -70,11 +70,8 @@ namespace tridot2d {
 
 	void UiElement::update() {
 		Camera* camera = Singleton::get<Camera>();
-		entity->position.x = position.x;
-		entity->position.y = camera->resolution.y - position.y;
-		entity->position.x += size.x * 0.5f;
-		entity->position.y -= size.y * 0.5f;
-		entity->scale = size;
+		entity->setPosition(glm::vec2(position.x + size.x * 0.5f, camera->resolution.y - position.y - size.y * 0.5f));
+		entity->setScale(size);
 	}
 
 	void UiText::update() {